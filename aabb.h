@@ -0,0 +1,62 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "ray.h"
+
+class AABB {
+public:
+	AABB() : _min(FLOAT_INF), _max(-FLOAT_INF) {}
+	AABB(const glm::vec3& min, const glm::vec3& max) : _min(min), _max(max) {}
+
+	const glm::vec3& min() const { return _min; }
+	const glm::vec3& max() const { return _max; }
+	glm::vec3 centroid() const { return 0.5f * (_min + _max); }
+	glm::vec3 extent() const { return _max - _min; }
+
+	void expand(const glm::vec3& p) {
+		_min = glm::min(_min, p);
+		_max = glm::max(_max, p);
+	}
+
+	void expand(const AABB& box) {
+		_min = glm::min(_min, box._min);
+		_max = glm::max(_max, box._max);
+	}
+
+	bool empty() const {
+		return _min.x > _max.x || _min.y > _max.y || _min.z > _max.z;
+	}
+
+	float surfaceArea() const {
+		if (empty()) return 0.0f;
+		glm::vec3 d = extent();
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	int maxExtent() const {
+		glm::vec3 d = extent();
+		if (d.x > d.y && d.x > d.z) return 0;
+		return d.y > d.z ? 1 : 2;
+	}
+
+	// slab 测试，invDir 为光线方向的倒数，命中区间与 [FLOAT_EPS, tMax] 相交时返回 true
+	bool rayHit(const glm::vec3& origin, const glm::vec3& invDir, float tMax) const {
+		glm::vec3 t0 = (_min - origin) * invDir;
+		glm::vec3 t1 = (_max - origin) * invDir;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, FLOAT_EPS));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+		return enter <= exit;
+	}
+
+private:
+	glm::vec3 _min;
+	glm::vec3 _max;
+};
+
+#endif // !AABB_H
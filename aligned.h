@@ -0,0 +1,62 @@
+#ifndef ALIGNED_H
+#define ALIGNED_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+inline void* alignedMalloc(std::size_t size, std::size_t alignment) {
+#ifdef _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	void* ptr = nullptr;
+	if (posix_memalign(&ptr, alignment, size) != 0) return nullptr;
+	return ptr;
+#endif
+}
+
+inline void alignedFree(void* ptr) {
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	std::free(ptr);
+#endif
+}
+
+// 按 Alignment 字节对齐分配内存的 STL 分配器
+template <typename T, std::size_t Alignment>
+class AlignedAllocator {
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(std::size_t n) {
+		if (n == 0) return nullptr;
+		void* ptr = alignedMalloc(n * sizeof(T), Alignment);
+		if (ptr == nullptr) throw std::bad_alloc();
+		return static_cast<T*>(ptr);
+	}
+
+	void deallocate(T* ptr, std::size_t) { alignedFree(ptr); }
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T, std::size_t Alignment = 32>
+using AlignedVector = std::vector<T, AlignedAllocator<T, Alignment>>;
+
+#endif // !ALIGNED_H
@@ -0,0 +1,82 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include "aligned.h"
+
+// 只增不减的内存池：对象在按缓存行对齐的大块内存中依次分配，相邻创建的对象在内存中也相邻。
+// 对象不能单独释放，内存池析构或 release() 时整块归还，耗时只与块数有关。
+// 因为不会调用析构函数，只接受平凡析构的类型
+class Arena {
+public:
+	static constexpr size_t BLOCK_ALIGNMENT = 64;
+	static constexpr size_t MAX_BLOCK_SIZE = size_t(64) << 20;
+
+	explicit Arena(size_t blockSize = 64 * 1024) : _blockSize(blockSize) {}
+	~Arena() { release(); }
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	template <typename T, typename... Args>
+	T* create(Args&&... args) {
+		static_assert(std::is_trivially_destructible<T>::value, "Arena never runs destructors");
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	void* allocate(size_t size, size_t alignment) {
+		size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+		if (_blocks.empty() || offset + size > _blocks.back().size) {
+			newBlock(size + alignment);
+			offset = 0;
+		}
+		_offset = offset + size;
+		_used += size;
+		return _blocks.back().data + offset;
+	}
+
+	// 确保接下来的 size 字节分配落在同一块内存中
+	void reserve(size_t size) {
+		if (_blocks.empty() || _offset + size > _blocks.back().size) newBlock(size);
+	}
+
+	// 归还全部内存，之前分配的对象随之失效
+	void release() {
+		for (const Block& block : _blocks) alignedFree(block.data);
+		_blocks.clear();
+		_offset = 0;
+		_used = 0;
+	}
+
+	size_t bytesUsed() const { return _used; }
+
+private:
+	struct Block {
+		unsigned char* data;
+		size_t size;
+	};
+
+	// 块的大小逐次翻倍，n 字节的对象只需 O(log n) 次系统分配
+	void newBlock(size_t minSize) {
+		size_t size = std::max(minSize, _blockSize);
+		void* data = alignedMalloc(size, BLOCK_ALIGNMENT);
+		if (data == nullptr) throw std::bad_alloc();
+		_blocks.push_back(Block{ static_cast<unsigned char*>(data), size });
+		_offset = 0;
+		_blockSize = std::min(_blockSize * 2, MAX_BLOCK_SIZE);
+	}
+
+	std::vector<Block> _blocks;
+	size_t _blockSize;
+	size_t _offset = 0;
+	size_t _used = 0;
+};
+
+#endif // !ARENA_H
@@ -0,0 +1,64 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include "sphere.h"
+#include "bvh.h"
+#include "lbvh.h"
+#include "parallel.h"
+
+// 构建时间基准：对不同规模的随机球体场景分别计时 SAH 构建与 LBVH 构建，
+// 输出总耗时与折算到每百万球体的耗时
+inline void benchmarkBuild(std::ostream& os) {
+	std::mt19937 gen(2020);
+	std::uniform_real_distribution<float> distribution(0.0, 1.0);
+
+	auto timeIt = [](const std::function<void()>& fn) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count();
+	};
+
+	os << "BUILD BENCHMARK (" << hardwareThreads() << " threads)" << std::endl;
+	os << std::setw(10) << "spheres" << std::setw(14) << "builder"
+		<< std::setw(12) << "ms" << std::setw(16) << "ms/Mprim" << std::endl;
+
+	const int sizes[] = { 100000, 1000000 };
+	for (int n : sizes) {
+		std::vector<Sphere> spheres;
+		spheres.reserve(n);
+		float side = std::cbrt(float(n)) * 2.0f;
+		for (int i = 0; i < n; i++) {
+			glm::vec3 center(distribution(gen), distribution(gen), distribution(gen));
+			spheres.emplace_back(center * side, 0.2f + 0.5f * distribution(gen), nullptr);
+		}
+		std::vector<Sphere*> world(n);
+		for (int i = 0; i < n; i++) world[i] = &spheres[i];
+
+		auto report = [&](const char* name, double ms) {
+			os << std::setw(10) << n << std::setw(14) << name << std::setw(12) << std::fixed
+				<< std::setprecision(1) << ms << std::setw(16) << ms * 1e6 / n << std::endl;
+		};
+
+		report("SAH", timeIt([&]() { BVH bvh(world.data(), n); }));
+		report("LBVH", timeIt([&]() {
+			LBVHBuilder builder(0, false);
+			BVH bvh(world.data(), builder.build(world.data(), n));
+		}));
+		report("LBVH+treelet", timeIt([&]() {
+			LBVHBuilder builder(0, true);
+			BVH bvh(world.data(), builder.build(world.data(), n));
+		}));
+	}
+}
+
+#endif // !BENCHMARK_H
@@ -0,0 +1,367 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+#include "ray.h"
+#include "aabb.h"
+#include "sphere.h"
+#include "aligned.h"
+#include "sphere_soa.h"
+
+// BVH 的构建方式
+enum class BVHBuildMethod {
+	Auto,	// 球体数不少于 LBVH_THRESHOLD 时用 LBVH，否则用 SAH
+	SAH,	// 逐层分桶的 SAH 构建，单线程，树的质量最好
+	LBVH	// 并行的 Morton 码构建加 treelet 重构，百万级球体的启动快一个数量级
+};
+
+// 构建阶段使用的树节点，构建完成后会被展开为 LinearBVHNode 数组
+struct BVHBuildNode {
+	AABB bounds;
+	int children[2] = { -1, -1 };  // 子节点在 BVHBuildResult::nodes 中的下标
+	int start = 0;  // 叶子节点在 index 中的起始下标
+	int count = 0;  // 叶子节点包含的球体个数，内部节点为 0
+	int axis = 0;   // 内部节点的划分轴
+};
+
+// 构建器的输出：节点池、根节点下标，以及按叶子顺序排列的球体下标
+struct BVHBuildResult {
+	std::vector<BVHBuildNode> nodes;
+	std::vector<int> index;
+	int root = -1;
+};
+
+// 深度优先排列的扁平节点，32 字节对齐，恰好占满半条缓存行。
+// 左子节点紧跟在父节点之后，offset 对内部节点表示右子节点下标，对叶子节点表示首个球体下标
+struct alignas(32) LinearBVHNode {
+	glm::vec3 min;
+	int offset;
+	glm::vec3 max;
+	unsigned short count;  // 叶子节点包含的球体个数，内部节点为 0
+	unsigned char axis;
+	unsigned char pad;
+};
+static_assert(sizeof(LinearBVHNode) == 32, "LinearBVHNode must be 32 bytes");
+
+// 以表面积启发式（SAH）构建的层次包围盒，用于替代对所有球体的线性求交
+class BVH {
+public:
+	static constexpr int SAH_BINS = 16;
+	// 树深的上限（根为第 0 层），遍历用的固定大小栈以此为容量。两种构建器都保证叶子不深于 MAX_DEPTH - 1
+	static constexpr int MAX_DEPTH = 64;
+
+	// 叶子的球体数上限，取本机最宽的向量内核一趟处理的球体数（SSE 4，AVX2 8，AVX-512 16），
+	// 使叶子求交恰好用满一次向量运算
+	static int leafSize() {
+		switch (simdLevel()) {
+		case SimdLevel::AVX512: return 16;
+		case SimdLevel::AVX2: return 8;
+		default: return 4;
+		}
+	}
+
+	// 按中位数逐层对半划分 count 个球体、叶子不超过 leafSize 个时，叶子所在的最大深度
+	static int balancedDepth(int count, int leafSize) {
+		int depth = 0;
+		for (; count > leafSize; depth++) count -= count / 2;
+		return depth;
+	}
+
+	// 深度为 depth 的节点分成 left 与 right 两部分后，两个子节点仍能在深度上限内建完
+	static bool withinDepth(int depth, int left, int right, int leafSize) {
+		return balancedDepth(std::max(left, right), leafSize) <= MAX_DEPTH - 2 - depth;
+	}
+
+	BVH() = default;
+
+	BVH(Sphere** world, int length) {
+		if (length == 0) return;
+		std::vector<AABB> bounds(length);
+		std::vector<glm::vec3> centroids(length);
+		for (int i = 0; i < length; i++) {
+			bounds[i] = world[i]->bounds();
+			centroids[i] = world[i]->center();
+		}
+
+		// 节点数至多为 2n - 1，预留后构建过程中不会重新分配
+		BVHBuildResult result;
+		result.index.resize(length);
+		for (int i = 0; i < length; i++) result.index[i] = i;
+		result.nodes.reserve(2 * length - 1);
+		_leafSize = leafSize();
+		result.root = build(result, bounds, centroids, 0, length, 0);
+		adopt(world, result);
+	}
+
+	// 使用其他构建器（如 LBVH）生成的层次结构
+	BVH(Sphere** world, const BVHBuildResult& result) {
+		adopt(world, result);
+	}
+
+	// 引用外部的节点数组与球体数据（如内存映射的场景缓存），不做任何构建。
+	// nodes 须在本对象的生命周期内保持有效
+	BVH(const LinearBVHNode* nodes, int nodeCount, SphereSoA&& spheres, std::vector<Material*> materials) :
+		_spheres(std::move(spheres)), _materials(std::move(materials)),
+		_nodePtr(nodeCount > 0 ? nodes : nullptr), _nodeCount(nodeCount) {}
+
+	BVH(const BVH&) = delete;
+	BVH& operator=(const BVH&) = delete;
+	BVH(BVH&&) = default;
+	BVH& operator=(BVH&&) = default;
+
+	// 最近交点查询，返回命中球体在叶子顺序中的下标并把距离写入 minT，未命中返回 -1
+	int intersectIndex(const Ray& ray, float& minT) const {
+		minT = FLOAT_INF;
+		int hit = -1;
+		if (_nodeCount == 0) return -1;
+
+		glm::vec3 invDir = 1.0f / ray.direction();
+		bool dirNeg[3] = { invDir.x < 0.0f, invDir.y < 0.0f, invDir.z < 0.0f };
+
+		int stack[MAX_DEPTH];
+		int top = 0;
+		int current = 0;
+		while (true) {
+			const LinearBVHNode& node = _nodePtr[current];
+			if (AABB(node.min, node.max).rayHit(ray.origin(), invDir, minT)) {
+				if (node.count > 0) {
+					_spheres.intersect(ray, node.offset, node.offset + node.count, minT, hit);
+					if (top == 0) break;
+					current = stack[--top];
+				}
+				else if (dirNeg[node.axis]) {
+					// 先访问近端子节点，远端子节点入栈
+					stack[top++] = current + 1;
+					current = node.offset;
+				}
+				else {
+					stack[top++] = node.offset;
+					current = current + 1;
+				}
+			}
+			else {
+				if (top == 0) break;
+				current = stack[--top];
+			}
+		}
+		return hit;
+	}
+
+	// 任意交点查询：光线在 (FLOAT_EPS, tMax) 内是否被遮挡，找到第一个交点即返回。
+	// 不区分远近子节点，也不记录最近距离与命中的球体，供阴影光线使用
+	bool occluded(const Ray& ray, float tMax) const {
+		if (_nodeCount == 0) return false;
+		glm::vec3 invDir = 1.0f / ray.direction();
+
+		int stack[MAX_DEPTH];
+		int top = 0;
+		int current = 0;
+		while (true) {
+			const LinearBVHNode& node = _nodePtr[current];
+			if (AABB(node.min, node.max).rayHit(ray.origin(), invDir, tMax)) {
+				if (node.count > 0) {
+					if (_spheres.occluded(ray, node.offset, node.offset + node.count, tMax)) return true;
+					if (top == 0) return false;
+					current = stack[--top];
+				}
+				else {
+					stack[top++] = node.offset;
+					current = current + 1;
+				}
+			}
+			else {
+				if (top == 0) return false;
+				current = stack[--top];
+			}
+		}
+	}
+
+	// 叶子的最大深度，根为第 0 层
+	int depth() const {
+		std::vector<int> level(_nodeCount, 0);
+		int deepest = 0;
+		for (int i = 0; i < _nodeCount; i++) {
+			const LinearBVHNode& node = _nodePtr[i];
+			deepest = std::max(deepest, level[i]);
+			if (node.count == 0) level[i + 1] = level[node.offset] = level[i] + 1;
+		}
+		return deepest;
+	}
+
+	int size() const { return _spheres.size(); }
+	const LinearBVHNode* nodes() const { return _nodePtr; }
+	int nodeCount() const { return _nodeCount; }
+	const SphereSoA& spheres() const { return _spheres; }
+	const std::vector<Material*>& materials() const { return _materials; }
+	// 叶子顺序中第 prim 个球体的材质
+	Material* material(int prim) const { return _materials[_spheres.material(prim)]; }
+
+private:
+	void adopt(Sphere** world, const BVHBuildResult& result) {
+		// 按叶子顺序重排球体，使每个叶子对应一段连续的几何数据
+		// 同一材质对象只分配一个编号
+		int length = int(result.index.size());
+		_spheres.resize(length);
+		_materials.clear();
+		std::unordered_map<Material*, int> materialIds;
+		for (int i = 0; i < length; i++) {
+			const Sphere* prim = world[result.index[i]];
+			auto found = materialIds.find(prim->material());
+			int material;
+			if (found == materialIds.end()) {
+				material = int(_materials.size());
+				materialIds[prim->material()] = material;
+				_materials.push_back(prim->material());
+			}
+			else {
+				material = found->second;
+			}
+			_spheres.set(i, prim->center(), prim->radius(), material);
+		}
+
+		_nodes.clear();
+		if (result.root >= 0) {
+			_nodes.reserve(result.nodes.size());
+			flatten(result, result.root);
+		}
+		_nodePtr = _nodes.empty() ? nullptr : _nodes.data();
+		_nodeCount = int(_nodes.size());
+	}
+
+	int build(BVHBuildResult& result, const std::vector<AABB>& bounds,
+		const std::vector<glm::vec3>& centroids, int start, int end, int depth) {
+		std::vector<int>& index = result.index;
+		int id = int(result.nodes.size());
+		result.nodes.push_back(BVHBuildNode());
+		BVHBuildNode* node = &result.nodes[id];
+		AABB centroidBounds;
+		for (int i = start; i < end; i++) {
+			node->bounds.expand(bounds[index[i]]);
+			centroidBounds.expand(centroids[index[i]]);
+		}
+
+		int count = end - start;
+		int axis = centroidBounds.maxExtent();
+		float lo = centroidBounds.min()[axis];
+		float hi = centroidBounds.max()[axis];
+		if (count <= _leafSize && (count <= 1 || hi <= lo || depth >= MAX_DEPTH - 1)) {
+			return makeLeaf(node, id, start, count);
+		}
+		if (hi <= lo) {
+			// 质心完全重合时无法按 SAH 划分，直接对半拆分以限制叶子大小
+			return makeInterior(result, bounds, centroids, id, axis, start, start + count / 2, end, depth);
+		}
+
+		// 分桶统计，再枚举 SAH_BINS - 1 个划分平面
+		AABB binBounds[SAH_BINS];
+		int binCount[SAH_BINS] = { 0 };
+		float scale = SAH_BINS / (hi - lo);
+		auto binOf = [&](int prim) {
+			int b = int((centroids[prim][axis] - lo) * scale);
+			return std::min(b, SAH_BINS - 1);
+		};
+		for (int i = start; i < end; i++) {
+			int b = binOf(index[i]);
+			binCount[b]++;
+			binBounds[b].expand(bounds[index[i]]);
+		}
+
+		float rightArea[SAH_BINS];
+		int rightCount[SAH_BINS];
+		AABB acc;
+		int accCount = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--) {
+			acc.expand(binBounds[b]);
+			accCount += binCount[b];
+			rightArea[b] = acc.surfaceArea();
+			rightCount[b] = accCount;
+		}
+
+		float bestCost = std::numeric_limits<float>::infinity();
+		int bestSplit = -1;
+		acc = AABB();
+		accCount = 0;
+		for (int b = 1; b < SAH_BINS; b++) {
+			acc.expand(binBounds[b - 1]);
+			accCount += binCount[b - 1];
+			float cost = accCount * acc.surfaceArea() + rightCount[b] * rightArea[b];
+			if (accCount > 0 && rightCount[b] > 0 && cost < bestCost) {
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		// 遍历一次节点的代价记为 1，与向量内核求交一组 _leafSize 个球体的代价相当
+		float leafCost = float((count + _leafSize - 1) / _leafSize);
+		float splitCost = 1.0f + bestCost / (_leafSize * node->bounds.surfaceArea());
+		if (count <= _leafSize && (bestSplit < 0 || leafCost <= splitCost)) {
+			return makeLeaf(node, id, start, count);
+		}
+		if (bestSplit < 0) {
+			return makeInterior(result, bounds, centroids, id, axis, start, start + count / 2, end, depth);
+		}
+
+		int* mid = std::partition(&index[start], &index[start] + count,
+			[&](int prim) { return binOf(prim) < bestSplit; });
+		int split = int(mid - &index[0]);
+		if (!withinDepth(depth, split - start, end - split, _leafSize)) {
+			// 极不均匀的分布（如按指数间隔排列的球体）会让 SAH 划分退化成长链，改按质心的中位数划分
+			split = start + count / 2;
+			std::nth_element(&index[start], &index[split], &index[start] + count,
+				[&](int a, int b) { return centroids[a][axis] < centroids[b][axis]; });
+		}
+		return makeInterior(result, bounds, centroids, id, axis, start, split, end, depth);
+	}
+
+	int makeLeaf(BVHBuildNode* node, int id, int start, int count) {
+		node->start = start;
+		node->count = count;
+		return id;
+	}
+
+	int makeInterior(BVHBuildResult& result, const std::vector<AABB>& bounds,
+		const std::vector<glm::vec3>& centroids, int id, int axis, int start, int split, int end, int depth) {
+		result.nodes[id].axis = axis;
+		int left = build(result, bounds, centroids, start, split, depth + 1);
+		int right = build(result, bounds, centroids, split, end, depth + 1);
+		result.nodes[id].children[0] = left;
+		result.nodes[id].children[1] = right;
+		return id;
+	}
+
+	int flatten(const BVHBuildResult& result, int id) {
+		const BVHBuildNode& node = result.nodes[id];
+		int index = int(_nodes.size());
+		_nodes.push_back(LinearBVHNode());
+		LinearBVHNode& linear = _nodes[index];
+		linear.min = node.bounds.min();
+		linear.max = node.bounds.max();
+		linear.count = (unsigned short)node.count;
+		linear.axis = (unsigned char)node.axis;
+		linear.pad = 0;
+		if (node.count > 0) {
+			linear.offset = node.start;
+		}
+		else {
+			flatten(result, node.children[0]);
+			int second = flatten(result, node.children[1]);
+			_nodes[index].offset = second;
+		}
+		return index;
+	}
+
+	SphereSoA _spheres;
+	std::vector<Material*> _materials;
+	AlignedVector<LinearBVHNode> _nodes;	// 自己构建时持有的节点，引用外部数据时为空
+	const LinearBVHNode* _nodePtr = nullptr;
+	int _nodeCount = 0;
+	int _leafSize = 4;	// SAH 构建时的叶子大小上限
+};
+
+#endif // !BVH_H
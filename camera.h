@@ -8,8 +8,7 @@
 #include <cmath>
 
 #include "ray.h"
-
-constexpr float PI = 3.14159265358979323846;
+#include "sampler.h"
 
 class Camera {
 public:
@@ -30,14 +29,30 @@ public:
 		vertical = 2.0f * half_height * v;
 	}
 
-	Ray get_ray(float s, float t) {
+	Ray get_ray(float s, float t) const {
 		return Ray(origin, lower_left_corner + s * horizontal + t * vertical);
 	}
 
+	// 宽 width、高 height 的图像中像素 (i, j) 的一条主光线（j 自下而上），像素内的位置取自 sampler 的下两维
+	Ray get_ray(int i, int j, int width, int height, Sampler& sampler) const {
+		glm::vec2 jitter = sampler.get2D();
+		return get_ray(float(i + jitter.x) / float(width), float(j + jitter.y) / float(height));
+	}
+
 	glm::vec3 origin;
 	glm::vec3 lower_left_corner;
 	glm::vec3 horizontal;
 	glm::vec3 vertical;
 };
 
+// 相机的摆放参数，宽高比在确定输出分辨率后才给出
+struct View {
+	glm::vec3 lookfrom = glm::vec3(13.0f, 2.0f, 3.0f);
+	glm::vec3 lookat = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	float vfov = 20.0f;
+
+	Camera camera(float aspect) const { return Camera(lookfrom, lookat, up, vfov, aspect); }
+};
+
 #endif // !CAMERA_H
@@ -0,0 +1,251 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+
+#include "bvh.h"
+#include "integrator.h"
+#include "output.h"
+
+// 运行时渲染配置，两个前端共用。来源依次为默认值、--config 指定的配置文件与命令行，后出现的覆盖先出现的
+struct RenderConfig {
+	int width = 1200;
+	int height = 800;
+	int samples = 100;
+	int threads = 0;		// 0 表示使用全部硬件线程
+	int tileSize = 16;
+	unsigned long long seed = 0;
+	SamplerType sampler = SamplerType::Independent;
+	BVHBuildMethod builder = BVHBuildMethod::Auto;
+	IntegratorSettings integrator;
+	OutputPolicy output;
+	std::string scene;		// 场景文件或场景缓存，为空时使用内置的随机场景
+	std::string writeCache;	// 非空时把场景写成此场景缓存后退出，不渲染
+	std::string sampleMap;	// 非空时在渲染结束后把每像素采样数写成此图像
+
+	bool help = false;
+	bool benchBuild = false;
+	bool selfTest = false;
+};
+
+namespace config_detail {
+
+inline bool parseInt(const std::string& text, int& value) {
+	char* end = nullptr;
+	errno = 0;
+	long v = std::strtol(text.c_str(), &end, 10);
+	if (text.empty() || *end != '\0' || errno != 0 || v < -2147483647L || v > 2147483647L) return false;
+	value = int(v);
+	return true;
+}
+
+inline bool parseDouble(const std::string& text, double& value) {
+	char* end = nullptr;
+	errno = 0;
+	value = std::strtod(text.c_str(), &end);
+	return !text.empty() && *end == '\0' && errno == 0;
+}
+
+inline bool parseBool(const std::string& text, bool& value) {
+	if (text == "true" || text == "1" || text == "yes" || text == "on") value = true;
+	else if (text == "false" || text == "0" || text == "no" || text == "off") value = false;
+	else return false;
+	return true;
+}
+
+inline std::string trim(const std::string& text) {
+	const char* space = " \t\r\n";
+	std::string::size_type begin = text.find_first_not_of(space);
+	if (begin == std::string::npos) return std::string();
+	return text.substr(begin, text.find_last_not_of(space) - begin + 1);
+}
+
+} // namespace config_detail
+
+// 设置一个选项，key 为不带 "--" 的选项名。配置文件中的 "key = value" 与命令行的 "--key value" 共用此函数
+inline bool applyConfigOption(RenderConfig& config, const std::string& key, const std::string& value,
+	std::string& error) {
+	using namespace config_detail;
+	bool ok = true;
+	unsigned long long seed;
+	double seconds;
+	double threshold;
+	if (key == "width") ok = parseInt(value, config.width) && config.width > 0;
+	else if (key == "height") ok = parseInt(value, config.height) && config.height > 0;
+	else if (key == "samples") ok = parseInt(value, config.samples) && config.samples > 0;
+	else if (key == "threads") ok = parseInt(value, config.threads) && config.threads >= 0;
+	else if (key == "tile") ok = parseInt(value, config.tileSize) && config.tileSize > 0;
+	else if (key == "seed") {
+		char* end = nullptr;
+		errno = 0;
+		seed = std::strtoull(value.c_str(), &end, 10);
+		ok = !value.empty() && *end == '\0' && errno == 0;
+		if (ok) config.seed = seed;
+	}
+	else if (key == "sampler") {
+		if (value == "independent") config.sampler = SamplerType::Independent;
+		else if (value == "stratified") config.sampler = SamplerType::Stratified;
+		else if (value == "sobol") config.sampler = SamplerType::Sobol;
+		else if (value == "bluenoise") config.sampler = SamplerType::BlueNoise;
+		else ok = false;
+	}
+	else if (key == "builder") {
+		if (value == "auto") config.builder = BVHBuildMethod::Auto;
+		else if (value == "sah") config.builder = BVHBuildMethod::SAH;
+		else if (value == "lbvh") config.builder = BVHBuildMethod::LBVH;
+		else ok = false;
+	}
+	else if (key == "max-depth") ok = parseInt(value, config.integrator.maxDepth) && config.integrator.maxDepth >= 0;
+	else if (key == "rr-depth") ok = parseInt(value, config.integrator.rouletteDepth) && config.integrator.rouletteDepth >= 0;
+	else if (key == "wavefront") ok = parseBool(value, config.integrator.wavefront);
+	else if (key == "packets") ok = parseBool(value, config.integrator.packets);
+	else if (key == "no-packets") {
+		bool noPackets;
+		ok = parseBool(value, noPackets);
+		if (ok) config.integrator.packets = !noPackets;
+	}
+	else if (key == "nee") ok = parseBool(value, config.integrator.nee);
+	else if (key == "sky") ok = parseBool(value, config.integrator.sky);
+	else if (key == "adaptive") {
+		ok = parseDouble(value, threshold) && threshold >= 0.0;
+		if (ok) config.integrator.adaptiveThreshold = float(threshold);
+	}
+	else if (key == "min-samples") {
+		ok = parseInt(value, config.integrator.adaptiveMinSamples) && config.integrator.adaptiveMinSamples >= 2;
+	}
+	else if (key == "split") {
+		bool split;
+		ok = parseBool(value, split);
+		if (ok) config.integrator.mode = split ? ScatterMode::Split : ScatterMode::Single;
+	}
+	else if (key == "output") config.output.path = value;
+	else if (key == "sample-map") config.sampleMap = value;
+	else if (key == "every") {
+		ok = parseInt(value, config.output.everySamples) && config.output.everySamples > 0;
+		config.output.mode = OutputPolicy::Mode::EverySamples;
+	}
+	else if (key == "interval") {
+		ok = parseDouble(value, seconds) && seconds > 0.0;
+		config.output.mode = OutputPolicy::Mode::EverySeconds;
+		config.output.everySeconds = seconds;
+	}
+	else if (key == "final-only") {
+		bool finalOnly;
+		ok = parseBool(value, finalOnly);
+		if (ok && finalOnly) config.output.mode = OutputPolicy::Mode::Final;
+	}
+	else if (key == "scene") config.scene = value;
+	else if (key == "write-cache") config.writeCache = value;
+	else {
+		error = "unknown option '" + key + "'";
+		return false;
+	}
+	if (!ok) error = "invalid value '" + value + "' for option '" + key + "'";
+	return ok;
+}
+
+// 读取配置文件：每行一个 "key = value"，# 之后为注释
+inline bool loadConfigFile(const std::string& path, RenderConfig& config, std::string& error) {
+	std::ifstream in(path);
+	if (!in) {
+		error = "failed to open config file " + path;
+		return false;
+	}
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++) {
+		std::string::size_type comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		line = config_detail::trim(line);
+		if (line.empty()) continue;
+
+		std::string::size_type eq = line.find('=');
+		if (eq == std::string::npos) {
+			error = path + ":" + std::to_string(number) + ": expected 'key = value'";
+			return false;
+		}
+		std::string key = config_detail::trim(line.substr(0, eq));
+		std::string value = config_detail::trim(line.substr(eq + 1));
+		if (!applyConfigOption(config, key, value, error)) {
+			error = path + ":" + std::to_string(number) + ": " + error;
+			return false;
+		}
+	}
+	return true;
+}
+
+// 检查选项之间的冲突。各来源都合并之后才能判断，由 parseCommandLine 在最后调用
+inline bool validateConfig(const RenderConfig& config, std::string& error) {
+	if (config.integrator.wavefront && config.integrator.mode == ScatterMode::Split) {
+		error = "--wavefront cannot be combined with --split: the wavefront integrator only traces single paths";
+		return false;
+	}
+	return true;
+}
+
+// 解析命令行，最后检查选项之间的冲突。不带值的开关：--wavefront、--no-packets、--split、--final-only、--bench-build、--self-test、--help
+inline bool parseCommandLine(int argc, char** argv, RenderConfig& config, std::string& error) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg.compare(0, 2, "--") != 0) {
+			error = "unexpected argument '" + arg + "'";
+			return false;
+		}
+		std::string key = arg.substr(2);
+		if (key == "help") config.help = true;
+		else if (key == "bench-build") config.benchBuild = true;
+		else if (key == "self-test") config.selfTest = true;
+		else if (key == "wavefront" || key == "no-packets" || key == "split" || key == "final-only") {
+			if (!applyConfigOption(config, key, "true", error)) return false;
+		}
+		else if (i + 1 >= argc) {
+			error = "missing value for '" + arg + "'";
+			return false;
+		}
+		else if (key == "config") {
+			if (!loadConfigFile(argv[++i], config, error)) return false;
+		}
+		else if (!applyConfigOption(config, key, argv[++i], error)) return false;
+	}
+	return validateConfig(config, error);
+}
+
+inline void printConfigUsage(std::ostream& os, const char* program) {
+	os << "usage: " << program << " [options]\n"
+		<< "  --config <file>    read options from a file of 'key = value' lines (keys as below, without --;\n"
+		<< "                     switches take true or false, e.g. 'no-packets = true')\n"
+		<< "  --scene <file>     scene file or scene cache (default: built-in random spheres)\n"
+		<< "  --write-cache <f>  build the BVH, write the scene as a binary scene cache and exit\n"
+		<< "  --width <n>        image width (default 1200)\n"
+		<< "  --height <n>       image height (default 800)\n"
+		<< "  --samples <n>      samples per pixel; the upper limit when --adaptive is on (default 100)\n"
+		<< "  --adaptive <e>     stop sampling a tile once every pixel's standard error, measured on the\n"
+		<< "                     gamma-encoded display value, is below e (e.g. 0.005); 0 disables (default 0)\n"
+		<< "  --min-samples <n>  samples every pixel takes before --adaptive may stop it (default 16)\n"
+		<< "  --threads <n>      render threads, 0 = all cores (default 0)\n"
+		<< "  --tile <n>         tile size in pixels; the wavefront integrator works on one tile per batch (default 16)\n"
+		<< "  --seed <n>         sampler seed, same seed gives the same image (default 0)\n"
+		<< "  --builder <name>   BVH builder: sah, lbvh (parallel) or auto = lbvh from 100000 spheres (default auto)\n"
+		<< "  --sampler <name>   independent, stratified, sobol (Owen-scrambled) or bluenoise (default independent)\n"
+		<< "  --max-depth <n>    maximum bounces per path (default 10)\n"
+		<< "  --rr-depth <n>     bounce at which Russian roulette starts (default 3)\n"
+		<< "  --wavefront        use the wavefront (ray-stream) integrator\n"
+		<< "  --no-packets       trace primary rays one at a time instead of in 8-ray packets\n"
+		<< "  --split            trace every scattered ray (reference mode, much slower; not with --wavefront)\n"
+		<< "  --nee <bool>       sample emissive spheres directly at diffuse hits, combined by MIS (default true)\n"
+		<< "  --sky <bool>       light the scene with the sky gradient; false gives a black background (default true)\n"
+		<< "  --output <file>    output image; .ppm (P6), .pfm (linear float) or .png (16-bit) (default image.ppm)\n"
+		<< "  --sample-map <f>   also write the per-pixel sample counts; raw counts in .pfm, scaled to the maximum otherwise\n"
+		<< "  --every <n>        also write <file>_<sample> every n samples\n"
+		<< "  --interval <s>     also write <file>_<sample> at most every s seconds\n"
+		<< "                     (intermediate images are never dropped; rendering waits when writing falls behind)\n"
+		<< "  --final-only       write only the final image\n"
+		<< "  --bench-build      run the BVH build benchmark and exit\n"
+		<< "  --self-test        check the SIMD kernels and BVH traversals against the scalar reference and exit\n";
+}
+
+#endif // !CONFIG_H
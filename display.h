@@ -0,0 +1,125 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstring>
+#include <cstddef>
+
+#include "shader.h"
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// 把整帧图像作为一张纹理上传，再用一个覆盖全屏的三角形绘制出来。
+// 驱动支持 ARB_buffer_storage 时使用持久映射的 PBO，否则每帧孤立（orphan）并重新映射 PBO
+class Display {
+public:
+	Display(int width, int height) :
+		_width(width), _height(height), _bytes(size_t(width) * height * 3 * sizeof(float)),
+		_shader("shader.vs", "shader.fs") {
+		// 全屏三角形的顶点由 gl_VertexID 生成，核心模式下仍需绑定一个空 VAO
+		glGenVertexArrays(1, &_vao);
+
+		glGenTextures(1, &_texture);
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenBuffers(1, &_pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+		typedef void (APIENTRYP BufferStorageProc)(GLenum, GLsizeiptr, const void*, GLbitfield);
+		BufferStorageProc bufferStorage = nullptr;
+		if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4) ||
+			glfwExtensionSupported("GL_ARB_buffer_storage")) {
+			bufferStorage = (BufferStorageProc)glfwGetProcAddress("glBufferStorage");
+		}
+		if (bufferStorage != nullptr) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			bufferStorage(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(_bytes), NULL, flags);
+			_mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(_bytes), flags);
+		}
+		else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(_bytes), NULL, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		_shader.use();
+		_shader.setInt("image", 0);
+	}
+
+	~Display() {
+		if (_fence != nullptr) glDeleteSync(_fence);
+		if (_mapped != nullptr) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &_pbo);
+		glDeleteTextures(1, &_texture);
+		glDeleteVertexArrays(1, &_vao);
+	}
+
+	Display(const Display&) = delete;
+	Display& operator=(const Display&) = delete;
+
+	bool persistent() const { return _mapped != nullptr; }
+
+	// rgb 为自下而上逐行排列的线性 RGB 浮点数据，共 width * height * 3 个
+	void upload(const float* rgb) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbo);
+		if (_mapped != nullptr) {
+			// 等待上一次从 PBO 到纹理的拷贝完成后再覆盖映射内存
+			if (_fence != nullptr) {
+				glClientWaitSync(_fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+				glDeleteSync(_fence);
+				_fence = nullptr;
+			}
+			std::memcpy(_mapped, rgb, _bytes);
+		}
+		else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(_bytes), NULL, GL_STREAM_DRAW);
+			void* ptr = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(_bytes),
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (ptr != nullptr) {
+				std::memcpy(ptr, rgb, _bytes);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+		}
+
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _width, _height, GL_RGB, GL_FLOAT, (void*)0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (_mapped != nullptr) _fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	void draw() {
+		_shader.use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		glBindVertexArray(_vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+
+private:
+	int _width;
+	int _height;
+	size_t _bytes;
+	Shader _shader;
+	GLuint _vao = 0;
+	GLuint _texture = 0;
+	GLuint _pbo = 0;
+	void* _mapped = nullptr;
+	GLsync _fence = nullptr;
+};
+
+#endif // !DISPLAY_H
@@ -0,0 +1,144 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "aligned.h"
+
+// 累积帧缓冲：保存每个像素线性辐亮度的和与采样数，按块优先（tile-major）排列，
+// 块的划分与 TileScheduler 相同，渲染一个块时访问的内存是连续的。行号 j 自下而上。
+// 另以 Welford 算法逐采样更新每个像素亮度（三通道平均）的均值与离差平方和，用于估计误差
+class Framebuffer {
+public:
+	Framebuffer(int width, int height, int tileSize = 16) :
+		_width(width), _height(height), _tileSize(tileSize),
+		_tilesX((width + tileSize - 1) / tileSize), _tilesY((height + tileSize - 1) / tileSize),
+		_texels(size_t(_tilesX) * _tilesY * tileSize * tileSize), _moments(_texels.size()) {}
+
+	int width() const { return _width; }
+	int height() const { return _height; }
+	int tileSize() const { return _tileSize; }
+
+	void add(int i, int j, const glm::vec3& radiance) {
+		size_t k = index(i, j);
+		Texel& texel = _texels[k];
+		texel.sum += radiance;
+		texel.count++;
+
+		Moments& moments = _moments[k];
+		float luminance = (radiance.x + radiance.y + radiance.z) / 3.0f;
+		float delta = luminance - moments.mean;
+		moments.mean += delta / float(texel.count);
+		moments.m2 += delta * (luminance - moments.mean);
+	}
+
+	glm::vec3 sum(int i, int j) const { return _texels[index(i, j)].sum; }
+	int samples(int i, int j) const { return int(_texels[index(i, j)].count); }
+
+	glm::vec3 average(int i, int j) const {
+		const Texel& texel = _texels[index(i, j)];
+		return texel.count == 0 ? glm::vec3(0.0f) : texel.sum / float(texel.count);
+	}
+
+	// 像素均值的估计误差，以显示值（gamma 2 编码并截断到 [0, 1]）衡量：均值偏离一个标准误时显示值的变化。
+	// 暗处的相对误差即使很大也不明显，亮处的饱和像素误差为 0。采样数不足 2 时无法估计，返回无穷大
+	float error(int i, int j) const {
+		size_t k = index(i, j);
+		uint32_t n = _texels[k].count;
+		if (n < 2) return std::numeric_limits<float>::infinity();
+		const Moments& moments = _moments[k];
+		float standardError = std::sqrt(moments.m2 / float(n - 1) / float(n));
+		float mean = std::min(std::max(moments.mean, 0.0f), 1.0f);
+		return std::sqrt(std::min(mean + standardError, 1.0f)) - std::sqrt(mean);
+	}
+
+	// 全部像素的采样数之和
+	unsigned long long totalSamples() const {
+		unsigned long long total = 0;
+		for (const Texel& texel : _texels) total += texel.count;
+		return total;
+	}
+
+	void clear() {
+		for (Texel& texel : _texels) texel = Texel();
+		for (Moments& moments : _moments) moments = Moments();
+	}
+
+	// 以自下而上逐行的线性 RGB 浮点数组导出平均值
+	void copyLinear(float* rgb) const { exportScanlines(rgb, false); }
+
+	// 同上，但做 gamma 2 编码，供显示使用
+	void copyGamma(float* rgb) const { exportScanlines(rgb, true); }
+
+	// 以自下而上逐行的 RGB 浮点数组导出每像素采样数（三个通道相同），scale 为乘在采样数上的系数
+	void copySampleCounts(float* rgb, float scale = 1.0f) const {
+		for (int j = 0; j < _height; j++) {
+			for (int i = 0; i < _width; i++) {
+				float* dst = rgb + (size_t(j) * _width + i) * 3;
+				dst[0] = dst[1] = dst[2] = float(_texels[index(i, j)].count) * scale;
+			}
+		}
+	}
+
+	int maxSamples() const {
+		uint32_t most = 0;
+		for (const Texel& texel : _texels) most = std::max(most, texel.count);
+		return int(most);
+	}
+
+private:
+	// 16 字节一个像素，一条缓存行恰好容纳 4 个
+	struct Texel {
+		glm::vec3 sum = glm::vec3(0.0f);
+		uint32_t count = 0;
+	};
+	static_assert(sizeof(Texel) == 16, "Texel must be 16 bytes");
+
+	// 单独存放，导出图像时不必读取
+	struct Moments {
+		float mean = 0.0f;
+		float m2 = 0.0f;
+	};
+
+	size_t index(int i, int j) const {
+		int tx = i / _tileSize, ty = j / _tileSize;
+		size_t tile = size_t(ty) * _tilesX + tx;
+		return tile * _tileSize * _tileSize + size_t(j - ty * _tileSize) * _tileSize + (i - tx * _tileSize);
+	}
+
+	// 按块读取、按行写出：块内每一行在源和目标中都是连续的一段
+	void exportScanlines(float* rgb, bool gamma) const {
+		for (int ty = 0; ty < _tilesY; ty++) {
+			for (int tx = 0; tx < _tilesX; tx++) {
+				int x0 = tx * _tileSize, y0 = ty * _tileSize;
+				int x1 = std::min(x0 + _tileSize, _width), y1 = std::min(y0 + _tileSize, _height);
+				for (int j = y0; j < y1; j++) {
+					const Texel* src = &_texels[index(x0, j)];
+					float* dst = rgb + (size_t(j) * _width + x0) * 3;
+					for (int i = x0; i < x1; i++, src++, dst += 3) {
+						glm::vec3 c = src->count == 0 ? glm::vec3(0.0f) : src->sum / float(src->count);
+						if (gamma) c = glm::vec3(std::sqrt(c.x), std::sqrt(c.y), std::sqrt(c.z));
+						dst[0] = c.x;
+						dst[1] = c.y;
+						dst[2] = c.z;
+					}
+				}
+			}
+		}
+	}
+
+	int _width;
+	int _height;
+	int _tileSize;
+	int _tilesX;
+	int _tilesY;
+	AlignedVector<Texel, 64> _texels;
+	AlignedVector<Moments, 64> _moments;
+};
+
+#endif // !FRAMEBUFFER_H
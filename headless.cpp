@@ -0,0 +1,103 @@
+// 无界面渲染入口：只依赖渲染核心，不链接 GLFW / OpenGL / glad，适合没有显示设备的渲染节点。
+// Windows 下使用 RayTracingHeadless.vcxproj；Linux 下可直接编译：
+//   g++ -std=c++14 -O2 -Iinclude headless.cpp -pthread -o RayTracingHeadless
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <string>
+#include <chrono>
+
+#include "scene.h"
+#include "renderer.h"
+#include "benchmark.h"
+#include "self_test.h"
+#include "output.h"
+#include "config.h"
+#include "scene_loader.h"
+
+int main(int argc, char** argv) {
+    const RenderConfig defaults;
+    RenderConfig config = defaults;
+    std::string error;
+    if (!parseCommandLine(argc, argv, config, error)) {
+        std::cout << error << std::endl;
+        printConfigUsage(std::cout, argv[0]);
+        return -1;
+    }
+    if (config.help) {
+        printConfigUsage(std::cout, argv[0]);
+        return 0;
+    }
+    if (config.benchBuild) {
+        benchmarkBuild(std::cout);
+        return 0;
+    }
+    if (config.selfTest) {
+        return runSelfTest(std::cout) ? 0 : -1;
+    }
+    std::unique_ptr<Scene> scene = prepareScene(argc, argv, defaults, config, error);
+    if (!scene) {
+        std::cout << error << std::endl;
+        return -1;
+    }
+    // 只生成场景缓存，供之后的渲染任务直接映射使用
+    if (!config.writeCache.empty()) {
+        if (!writeSceneCache(config.writeCache, *scene, config.builder, config.threads, error)) {
+            std::cout << error << std::endl;
+            return -1;
+        }
+        std::cout << "WROTE SCENE CACHE: " << config.writeCache << std::endl;
+        return 0;
+    }
+
+    int width = config.width;
+    int height = config.height;
+    int samples = config.samples;
+    const OutputPolicy& output = config.output;
+
+    Renderer renderer(*scene, width, height, config.tileSize, config.threads,
+        Sampler(config.seed, config.sampler, samples), config.builder);
+    renderer.setSettings(config.integrator);
+    std::cout << "BVH WIDTH: " << renderer.bvh().width() << std::endl;
+    std::cout << "RENDER THREADS: " << renderer.threads() << std::endl;
+
+    // 中间结果与最终结果都交给后台线程写出，渲染循环只做一次缓冲拷贝
+    ImageWriter writer;
+    size_t pixels = size_t(width) * height * 3;
+    auto start = std::chrono::steady_clock::now();
+    auto lastWrite = start;
+    for (int sample = 1; sample <= samples; sample++) {
+        renderer.renderSample();
+        std::cout << "SAMPLE TIMES: " << sample << std::endl;
+        // 自适应采样：所有块都已收敛时提前结束
+        if (renderer.converged()) {
+            std::cout << "CONVERGED AFTER: " << sample << " samples" << std::endl;
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (sample < samples && output.due(sample, std::chrono::duration<double>(now - lastWrite).count())) {
+            std::vector<float> snapshot(pixels);
+            renderer.copyLinear(snapshot.data());
+            writer.submit(std::move(snapshot), width, height, output.intermediatePath(sample));
+            lastWrite = now;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "RENDER TIME: " << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+    unsigned long long pixelSamples = renderer.framebuffer().totalSamples();
+    std::cout << "SAMPLES PER PIXEL: " << double(pixelSamples) / (double(width) * height) << std::endl;
+    std::cout << "SEGMENTS PER SAMPLE: " << double(renderer.segments()) / double(pixelSamples) << std::endl;
+
+    std::vector<float> snapshot(pixels);
+    renderer.copyLinear(snapshot.data());
+    writer.submit(std::move(snapshot), width, height, output.path);
+    if (!config.sampleMap.empty()) {
+        std::vector<float> counts(pixels);
+        renderer.copySampleCounts(counts.data(), imageFormatFromPath(config.sampleMap) != ImageFormat::PFM);
+        writer.submit(std::move(counts), width, height, config.sampleMap);
+    }
+    writer.flush();
+    return 0;
+}
@@ -0,0 +1,184 @@
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cctype>
+
+// 输出图像格式：P6 与 PNG 为 gamma 2 编码的低动态范围图像，PFM 保存线性的浮点辐亮度
+enum class ImageFormat {
+	PPM,	// 二进制 PPM（P6），每通道 8 位
+	PFM,	// 便携浮点图（PF），每通道 32 位浮点
+	PNG16	// 每通道 16 位的 PNG，IDAT 使用不压缩的 deflate 存储块
+};
+
+// 按扩展名推断格式，无法识别时使用 PPM
+inline ImageFormat imageFormatFromPath(const std::string& path) {
+	std::string::size_type dot = path.find_last_of('.');
+	std::string ext = dot == std::string::npos ? std::string() : path.substr(dot + 1);
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return char(std::tolower(c)); });
+	if (ext == "pfm") return ImageFormat::PFM;
+	if (ext == "png") return ImageFormat::PNG16;
+	return ImageFormat::PPM;
+}
+
+namespace image_detail {
+
+inline float encodeGamma(float linear) {
+	return std::sqrt(std::min(std::max(linear, 0.0f), 1.0f));
+}
+
+struct CrcTable {
+	CrcTable() {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			value[n] = c;
+		}
+	}
+	uint32_t value[256];
+};
+
+inline uint32_t crc32(const unsigned char* data, size_t length, uint32_t crc = 0) {
+	static const CrcTable table;
+	crc = ~crc;
+	for (size_t i = 0; i < length; i++) crc = table.value[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+inline void putBigEndian32(std::vector<unsigned char>& out, uint32_t v) {
+	out.push_back((unsigned char)(v >> 24));
+	out.push_back((unsigned char)(v >> 16));
+	out.push_back((unsigned char)(v >> 8));
+	out.push_back((unsigned char)v);
+}
+
+inline void writeChunk(std::ostream& os, const char* type, const std::vector<unsigned char>& data) {
+	std::vector<unsigned char> chunk(type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	std::vector<unsigned char> header;
+	putBigEndian32(header, uint32_t(data.size()));
+	std::vector<unsigned char> crc;
+	putBigEndian32(crc, crc32(chunk.data(), chunk.size()));
+	os.write((const char*)header.data(), header.size());
+	os.write((const char*)chunk.data(), chunk.size());
+	os.write((const char*)crc.data(), crc.size());
+}
+
+} // namespace image_detail
+
+// 以下写出函数的 rgb 均为自下而上逐行排列的线性 RGB 浮点数据，共 width * height * 3 个
+
+inline bool writePPM(std::ostream& os, int width, int height, const float* rgb) {
+	os << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<unsigned char> row(size_t(width) * 3);
+	for (int j = height - 1; j >= 0; j--) {
+		const float* src = rgb + size_t(j) * width * 3;
+		for (int i = 0; i < width * 3; i++) {
+			row[i] = (unsigned char)(255.99f * image_detail::encodeGamma(src[i]));
+		}
+		os.write((const char*)row.data(), row.size());
+	}
+	return bool(os);
+}
+
+// PFM 本身就按自下而上的行序存储，比例因子为负表示小端
+inline bool writePFM(std::ostream& os, int width, int height, const float* rgb) {
+	os << "PF\n" << width << " " << height << "\n-1.0\n";
+	const uint16_t probe = 1;
+	bool littleEndian = *(const unsigned char*)&probe == 1;
+	if (littleEndian) {
+		os.write((const char*)rgb, std::streamsize(size_t(width) * height * 3 * sizeof(float)));
+	}
+	else {
+		std::vector<unsigned char> row(size_t(width) * 3 * sizeof(float));
+		for (int j = 0; j < height; j++) {
+			const unsigned char* src = (const unsigned char*)(rgb + size_t(j) * width * 3);
+			for (size_t k = 0; k < row.size(); k += 4) {
+				for (int b = 0; b < 4; b++) row[k + b] = src[k + 3 - b];
+			}
+			os.write((const char*)row.data(), row.size());
+		}
+	}
+	return bool(os);
+}
+
+// 16 位 PNG：未经压缩的 deflate 存储块只需计算 Adler-32 与 CRC-32，写出开销接近直接拷贝
+inline bool writePNG16(std::ostream& os, int width, int height, const float* rgb) {
+	using namespace image_detail;
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	os.write((const char*)signature, 8);
+
+	std::vector<unsigned char> ihdr;
+	putBigEndian32(ihdr, uint32_t(width));
+	putBigEndian32(ihdr, uint32_t(height));
+	ihdr.push_back(16);	// 位深
+	ihdr.push_back(2);	// RGB
+	ihdr.push_back(0);
+	ihdr.push_back(0);
+	ihdr.push_back(0);
+	writeChunk(os, "IHDR", ihdr);
+
+	// 每行前加一个过滤类型字节（0，不过滤）
+	size_t stride = 1 + size_t(width) * 6;
+	std::vector<unsigned char> raw(stride * height);
+	for (int j = 0; j < height; j++) {
+		unsigned char* dst = raw.data() + stride * (height - 1 - j);
+		const float* src = rgb + size_t(j) * width * 3;
+		*dst++ = 0;
+		for (int i = 0; i < width * 3; i++) {
+			uint16_t v = uint16_t(65535.0f * encodeGamma(src[i]) + 0.5f);
+			*dst++ = (unsigned char)(v >> 8);
+			*dst++ = (unsigned char)v;
+		}
+	}
+
+	const size_t BLOCK = 65535;
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / BLOCK * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	uint32_t a = 1, b = 0;
+	for (size_t pos = 0; pos < raw.size() || pos == 0; pos += BLOCK) {
+		size_t len = std::min(BLOCK, raw.size() - pos);
+		bool last = pos + len >= raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back((unsigned char)len);
+		zlib.push_back((unsigned char)(len >> 8));
+		zlib.push_back((unsigned char)~len);
+		zlib.push_back((unsigned char)(~len >> 8));
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+		// 5552 字节内 b 不会溢出 32 位，取模可以成批进行
+		for (size_t k = pos; k < pos + len; ) {
+			size_t stop = std::min(pos + len, k + 5552);
+			for (; k < stop; k++) {
+				a += raw[k];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		if (last) break;
+	}
+	putBigEndian32(zlib, (b << 16) | a);
+	writeChunk(os, "IDAT", zlib);
+	writeChunk(os, "IEND", std::vector<unsigned char>());
+	return bool(os);
+}
+
+inline bool writeImage(const std::string& path, ImageFormat format, int width, int height, const float* rgb) {
+	std::ofstream os(path, std::ios::binary);
+	if (!os) return false;
+	switch (format) {
+	case ImageFormat::PFM: return writePFM(os, width, height, rgb);
+	case ImageFormat::PNG16: return writePNG16(os, width, height, rgb);
+	default: return writePPM(os, width, height, rgb);
+	}
+}
+
+#endif // !IMAGE_IO_H
@@ -0,0 +1,239 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "ray.h"
+#include "sphere.h"
+#include "material.h"
+#include "wide_bvh.h"
+#include "sampler.h"
+#include "lights.h"
+
+// 散射产生多条出射光线（如电介质的反射与折射）时的处理方式
+enum class ScatterMode {
+	Single,	// 按衰减的相对大小随机选一条并除以选中概率，每个采样只追踪一条路径（无偏）
+	Split	// 追踪全部出射光线，路径数随深度指数增长，仅作参考
+};
+
+// 积分器参数，可在运行时修改
+struct IntegratorSettings {
+	int maxDepth = 10;		// 最大弹射次数
+	int rouletteDepth = 3;	// 从第几次弹射开始做俄罗斯轮盘赌，不小于 maxDepth 时不做
+	ScatterMode mode = ScatterMode::Single;
+	bool wavefront = false;	// 使用波前积分器（只支持 ScatterMode::Single）
+	bool packets = true;	// 主光线以 8 条为一包求交（需要 AVX2，只用于 ScatterMode::Single）
+	bool nee = true;		// 在漫反射表面采样发光球体（下一事件估计），与 BSDF 采样做多重重要性采样
+	bool sky = true;		// 未命中的光线取天空颜色，关闭时背景为黑色（只由发光球体照明）
+	float adaptiveThreshold = 0.0f;	// 自适应采样：块内全部像素的估计误差（显示值）低于此值后不再采样，0 表示关闭
+	int adaptiveMinSamples = 16;	// 自适应采样前每个像素至少取的采样数，太少时方差估计不可靠
+};
+
+inline glm::vec3 skyColor(const Ray& ray) {
+	if (ray.direction().y != ray.direction().y) return glm::vec3(0.0f);
+	float t = 0.5f * (ray.direction().y + 1.0f);
+	return (1.0f - t) * glm::vec3(1.0f, 1.0f, 1.0f) + t * glm::vec3(0.5f, 0.7f, 1.0f);
+}
+
+inline glm::vec3 background(const Ray& ray, const IntegratorSettings& settings) {
+	return settings.sky ? skyColor(ray) : glm::vec3(0.0f);
+}
+
+// 按平均衰减从散射结果中随机选一条出射光线，pdf 返回选中的概率；全部衰减为 0 时返回 -1
+inline int chooseScatter(const ScatterRecord& rec, Sampler& sampler, float& pdf) {
+	if (rec.count == 1) {
+		pdf = 1.0f;
+		return 0;
+	}
+
+	float weight[ScatterRecord::MAX_RAYS];
+	float total = 0.0f;
+	for (int i = 0; i < rec.count; i++) {
+		const glm::vec3& a = rec.attenuations[i];
+		weight[i] = (a.x + a.y + a.z) / 3.0f;
+		total += weight[i];
+	}
+	if (total <= 0.0f) return -1;
+
+	float u = sampler.get1D() * total;
+	int chosen = rec.count - 1;
+	for (int i = 0; i < rec.count - 1; i++) {
+		if (u < weight[i]) {
+			chosen = i;
+			break;
+		}
+		u -= weight[i];
+	}
+	pdf = weight[chosen] / total;
+	return chosen;
+}
+
+// 路径的一次弹射：从散射结果中选出下一条光线并更新通量，
+// 超过 rouletteDepth 后以通量最大分量为存活概率做俄罗斯轮盘赌。路径终止时返回 false
+inline bool advancePath(const ScatterRecord& rec, int depth, const IntegratorSettings& settings,
+	Sampler& sampler, glm::vec3& throughput, Ray& ray) {
+	if (rec.count == 0) return false;
+	float pdf;
+	int chosen = chooseScatter(rec, sampler, pdf);
+	if (chosen < 0) return false;
+	throughput *= rec.attenuations[chosen] / pdf;
+	ray = rec.rays[chosen];
+
+	if (depth + 1 >= settings.rouletteDepth) {
+		float survive = std::min(std::max(throughput.x, std::max(throughput.y, throughput.z)), 0.95f);
+		if (sampler.get1D() >= survive) return false;
+		throughput /= survive;
+	}
+	return true;
+}
+
+// 多重重要性采样所需的上一个交点的信息：漫反射采样出当前方向的概率密度与该交点的法线。
+// bsdfPdf 为 0（相机光线、镜面散射之后或关闭了直接光照采样）时光源采样不会产生这条路径
+struct MISState {
+	float bsdfPdf = 0.0f;
+	glm::vec3 normal = glm::vec3(0.0f);
+};
+
+// 命中发光球体时计入的辐亮度（未乘通量），只有从球外射入才可见。光源选择概率取决于上一个交点的位置与法线
+inline glm::vec3 emittedRadiance(const Emissive* light, const Ray& ray, int hit, const glm::vec3& center, float t,
+	const MISState& mis, const LightSet& lights) {
+	if (glm::dot(ray.direction(), ray.at(t) - center) >= 0.0f) return glm::vec3(0.0f);
+	if (mis.bsdfPdf <= 0.0f) return light->radiance();
+	return powerHeuristic(mis.bsdfPdf, lights.pdf(ray.origin(), mis.normal, hit)) * light->radiance();
+}
+
+// 直接光照采样（下一事件估计）：只对漫反射表面进行，其余材质没有可供采样的光滑 BSDF
+template <typename M>
+inline glm::vec3 directLight(const M* /*material*/, const Ray& /*ray*/, const glm::vec3& /*center*/, float /*t*/,
+	const WideBVH& /*bvh*/, const LightSet& /*lights*/, Sampler& /*sampler*/, int& /*segments*/) {
+	return glm::vec3(0.0f);
+}
+
+// 漫反射命中点的直接光照（未乘通量）：选一个光源、在其所张圆锥内取方向并以任意交点查询测试遮挡，
+// 按幂启发式与 BSDF 采样命中光源的贡献结合。无论是否可见都消耗同样多的随机数
+inline glm::vec3 directLight(const Lambertian* material, const Ray& ray, const glm::vec3& center, float t,
+	const WideBVH& bvh, const LightSet& lights, Sampler& sampler, int& segments) {
+	float u = sampler.get1D();
+	glm::vec2 u2 = sampler.get2D();
+	glm::vec3 point = ray.at(t);
+	glm::vec3 normal = glm::normalize(point - center);
+	LightSample light;
+	if (!lights.sample(point, normal, u, u2, light)) return glm::vec3(0.0f);
+	float cosine = glm::dot(normal, light.direction);
+	if (cosine <= 0.0f) return glm::vec3(0.0f);
+
+	// 光源自身的交点恰在 distance 处，严格小于的比较不会把它算作遮挡
+	segments++;
+	if (bvh.occluded(Ray::fromDirection(point, light.direction), light.distance)) return glm::vec3(0.0f);
+	float weight = powerHeuristic(light.pdf, cosine / PI);
+	return material->evaluate() * light.radiance * (cosine * weight / light.pdf);
+}
+
+// 路径在非发光交点处的一次弹射：散射、漫反射处的直接光照（累加进 radiance），再选出下一条光线。
+// mis 传出本次散射方向的概率密度与交点法线，供下一个交点计算发光的 MIS 权重。路径终止时返回 false
+template <typename M>
+inline bool scatterVertex(M* material, Ray& ray, int hit, float t, int depth, const WideBVH& bvh,
+	const LightSet& lights, Sampler& sampler, const IntegratorSettings& settings, glm::vec3& throughput,
+	MISState& mis, glm::vec3& radiance, int& segments) {
+	glm::vec3 center = bvh.binary().spheres().center(hit);
+	ScatterRecord rec = material->M::scatter(ray, center, t, sampler);
+	bool nee = settings.nee && !lights.empty();
+	if (nee) radiance += throughput * directLight(material, ray, center, t, bvh, lights, sampler, segments);
+	mis.bsdfPdf = nee ? rec.pdf : 0.0f;
+	mis.normal = glm::normalize(ray.at(t) - center);
+	return advancePath(rec, depth, settings, sampler, throughput, ray);
+}
+
+inline bool scatterVertex(Material* material, Ray& ray, int hit, float t, int depth, const WideBVH& bvh,
+	const LightSet& lights, Sampler& sampler, const IntegratorSettings& settings, glm::vec3& throughput,
+	MISState& mis, glm::vec3& radiance, int& segments) {
+	switch (material->kind()) {
+	case MaterialKind::Lambertian:
+		return scatterVertex(static_cast<Lambertian*>(material), ray, hit, t, depth, bvh, lights, sampler, settings,
+			throughput, mis, radiance, segments);
+	case MaterialKind::Metal:
+		return scatterVertex(static_cast<Metal*>(material), ray, hit, t, depth, bvh, lights, sampler, settings,
+			throughput, mis, radiance, segments);
+	case MaterialKind::Dielectric:
+		return scatterVertex(static_cast<Dielectric*>(material), ray, hit, t, depth, bvh, lights, sampler, settings,
+			throughput, mis, radiance, segments);
+	default:
+		return false;
+	}
+}
+
+// 迭代式路径追踪：从已求得的第一个交点（hit 为球体在 BVH 叶子顺序中的下标，-1 表示未命中）开始，
+// 沿单条路径累乘通量。segments 累加本次追踪的光线段数（含阴影光线），不含第一段
+inline glm::vec3 continuePath(Ray ray, int hit, float minT, const WideBVH& bvh, const LightSet& lights,
+	Sampler& sampler, const IntegratorSettings& settings, int& segments) {
+	const BVH& binary = bvh.binary();
+	glm::vec3 throughput(1.0f);
+	glm::vec3 radiance(0.0f);
+	MISState mis;
+	for (int depth = 0; ; depth++) {
+		if (depth > 0) {
+			hit = bvh.intersectIndex(ray, minT);
+			segments++;
+		}
+		if (hit < 0) return radiance + throughput * background(ray, settings);
+		Material* material = binary.material(hit);
+		if (material->kind() == MaterialKind::Emissive) {
+			return radiance + throughput * emittedRadiance(static_cast<Emissive*>(material), ray, hit,
+				binary.spheres().center(hit), minT, mis, lights);
+		}
+		if (depth >= settings.maxDepth) return radiance;
+
+		if (!scatterVertex(material, ray, hit, minT, depth, bvh, lights, sampler, settings, throughput, mis,
+			radiance, segments)) {
+			return radiance;
+		}
+	}
+}
+
+inline glm::vec3 tracePath(const Ray& ray, const WideBVH& bvh, const LightSet& lights, Sampler& sampler,
+	const IntegratorSettings& settings, int& segments) {
+	float minT;
+	int hit = bvh.intersectIndex(ray, minT);
+	segments++;
+	return continuePath(ray, hit, minT, bvh, lights, sampler, settings, segments);
+}
+
+// 递归地追踪每一条出射光线（ScatterMode::Split 的参考实现）
+inline glm::vec3 color(const Ray& ray, const WideBVH& bvh, const LightSet& lights, Sampler& sampler, int depth,
+	const IntegratorSettings& settings, int& segments, const MISState& mis = MISState()) {
+	float minT;
+	int hit = bvh.intersectIndex(ray, minT);
+	segments++;
+	if (hit < 0) return background(ray, settings);
+	const BVH& binary = bvh.binary();
+	Material* material = binary.material(hit);
+	glm::vec3 center = binary.spheres().center(hit);
+	if (material->kind() == MaterialKind::Emissive) {
+		return emittedRadiance(static_cast<Emissive*>(material), ray, hit, center, minT, mis, lights);
+	}
+	if (depth >= settings.maxDepth) return glm::vec3(0.0f);
+
+	ScatterRecord rec = material->scatter(ray, center, minT, sampler);
+	glm::vec3 result(0.0f);
+	bool nee = settings.nee && !lights.empty();
+	MISState next;
+	next.bsdfPdf = nee ? rec.pdf : 0.0f;
+	next.normal = glm::normalize(ray.at(minT) - center);
+	if (nee && material->kind() == MaterialKind::Lambertian) {
+		result += directLight(static_cast<Lambertian*>(material), ray, center, minT, bvh, lights, sampler, segments);
+	}
+	for (int i = 0; i < rec.count; i++) {
+		result += rec.attenuations[i] * color(rec.rays[i], bvh, lights, sampler, depth + 1, settings, segments, next);
+	}
+	return result;
+}
+
+inline glm::vec3 radiance(const Ray& ray, const WideBVH& bvh, const LightSet& lights, Sampler& sampler,
+	const IntegratorSettings& settings, int& segments) {
+	if (settings.mode == ScatterMode::Split) return color(ray, bvh, lights, sampler, 0, settings, segments);
+	return tracePath(ray, bvh, lights, sampler, settings, segments);
+}
+
+#endif // !INTEGRATOR_H
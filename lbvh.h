@@ -0,0 +1,304 @@
+#ifndef LBVH_H
+#define LBVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "aabb.h"
+#include "sphere.h"
+#include "bvh.h"
+#include "parallel.h"
+
+// 基于 Morton 码的线性 BVH 构建器：并行计算球心的 Morton 码、并行基数排序，
+// 再按编码最高的不同位自顶向下划分生成层次结构，可选地用 treelet 重构做 SAH 优化。
+// 构建速度远快于逐层分桶的 SAH 构建，适合百万级球体的场景启动。树深不超过 BVH::MAX_DEPTH
+class LBVHBuilder {
+public:
+	static constexpr int TREELET_SIZE = 5;
+
+	// threads 为 0 时使用全部硬件线程，叶子大小上限与 SAH 构建相同，取 BVH::leafSize()
+	explicit LBVHBuilder(int threads = 0, bool optimize = true) :
+		_threads(threads > 0 ? threads : hardwareThreads()), _optimize(optimize), _leafSize(BVH::leafSize()) {}
+
+	BVHBuildResult build(Sphere** world, int length) {
+		BVHBuildResult result;
+		if (length == 0) return result;
+
+		_bounds.resize(length);
+		parallelFor(length, _threads, [&](int, int begin, int end) {
+			for (int i = begin; i < end; i++) _bounds[i] = world[i]->bounds();
+		});
+		AABB centroidBounds;
+		for (int i = 0; i < length; i++) centroidBounds.expand(world[i]->center());
+
+		// 高 32 位为 Morton 码，低 32 位为球体下标
+		std::vector<uint64_t> keys(length);
+		glm::vec3 lo = centroidBounds.min();
+		glm::vec3 extent = glm::max(centroidBounds.extent(), glm::vec3(1e-12f));
+		parallelFor(length, _threads, [&](int, int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				glm::vec3 p = (world[i]->center() - lo) / extent;
+				keys[i] = (uint64_t(morton3D(p)) << 32) | uint32_t(i);
+			}
+		});
+		radixSort(keys);
+
+		_codes.resize(length);
+		result.index.resize(length);
+		for (int i = 0; i < length; i++) {
+			_codes[i] = uint32_t(keys[i] >> 32);
+			result.index[i] = int(keys[i] & 0xffffffffu);
+		}
+
+		result.nodes.resize(2 * length - 1);
+		_cost.assign(2 * length - 1, 0.0f);
+		_height.assign(2 * length - 1, 0);
+		_nodeCount = 0;
+		int spawnDepth = 0;
+		while ((1 << spawnDepth) < _threads) spawnDepth++;
+		result.root = emit(result, 0, length, spawnDepth, 0);
+		result.nodes.resize(_nodeCount.load());
+		return result;
+	}
+
+private:
+	// 将 10 位整数的每一位之间插入两个 0
+	static uint32_t expandBits(uint32_t v) {
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	// p 的各分量在 [0, 1] 内，返回 30 位 Morton 码，位序为 x y z 交替
+	static uint32_t morton3D(const glm::vec3& p) {
+		glm::vec3 q = glm::clamp(p * 1024.0f, glm::vec3(0.0f), glm::vec3(1023.0f));
+		return (expandBits(uint32_t(q.x)) << 2) | (expandBits(uint32_t(q.y)) << 1) | expandBits(uint32_t(q.z));
+	}
+
+	static int highestBit(uint32_t v) {
+		int bit = 31;
+		while (!(v & (1u << bit))) bit--;
+		return bit;
+	}
+
+	// 按高 32 位做 LSD 基数排序，每趟 8 位，各线程先统计本段直方图再并行分发
+	void radixSort(std::vector<uint64_t>& keys) {
+		int n = int(keys.size());
+		int threads = std::max(1, std::min(_threads, n / 4096 + 1));
+		std::vector<uint64_t> temp(n);
+		std::vector<std::vector<int>> histogram(threads, std::vector<int>(256));
+
+		for (int pass = 0; pass < 4; pass++) {
+			int shift = 32 + 8 * pass;
+			parallelFor(n, threads, [&](int t, int begin, int end) {
+				std::vector<int>& h = histogram[t];
+				std::fill(h.begin(), h.end(), 0);
+				for (int i = begin; i < end; i++) h[(keys[i] >> shift) & 0xff]++;
+			});
+
+			int offset = 0;
+			for (int digit = 0; digit < 256; digit++) {
+				for (int t = 0; t < threads; t++) {
+					int count = histogram[t][digit];
+					histogram[t][digit] = offset;
+					offset += count;
+				}
+			}
+
+			parallelFor(n, threads, [&](int t, int begin, int end) {
+				std::vector<int>& h = histogram[t];
+				for (int i = begin; i < end; i++) temp[h[(keys[i] >> shift) & 0xff]++] = keys[i];
+			});
+			keys.swap(temp);
+		}
+	}
+
+	// depth 为节点的深度，子树的高度（叶子为 0）保持在 BVH::MAX_DEPTH - 1 - depth 以内
+	int emit(BVHBuildResult& result, int start, int end, int spawnDepth, int depth) {
+		int id = _nodeCount++;
+		BVHBuildNode& node = result.nodes[id];
+		int count = end - start;
+		if (count <= _leafSize) {
+			node.start = start;
+			node.count = count;
+			for (int i = start; i < end; i++) node.bounds.expand(_bounds[result.index[i]]);
+			// 与 SAH 构建的代价模型一致：一组 _leafSize 个球体的求交与遍历一次节点的代价相当
+			_cost[id] = float((count + _leafSize - 1) / _leafSize) * node.bounds.surfaceArea();
+			_height[id] = 0;
+			return id;
+		}
+
+		// 在编码最高的不同位处划分；编码完全相同时对半拆分
+		int split;
+		uint32_t first = _codes[start];
+		uint32_t last = _codes[end - 1];
+		if (first == last) {
+			split = start + count / 2;
+			node.axis = -1;
+		}
+		else {
+			int bit = highestBit(first ^ last);
+			uint32_t mask = 1u << bit;
+			split = int(std::partition_point(_codes.begin() + start, _codes.begin() + end,
+				[=](uint32_t code) { return (code & mask) == 0; }) - _codes.begin());
+			node.axis = 2 - bit % 3;
+			// 坐标按指数分布时 Morton 码的划分极不均匀，树会退化成长链，余下的层数不够时改为对半拆分
+			if (!BVH::withinDepth(depth, split - start, end - split, _leafSize)) {
+				split = start + count / 2;
+				node.axis = -1;
+			}
+		}
+
+		int left, right;
+		if (spawnDepth > 0) {
+			std::thread worker([&]() { left = emit(result, start, split, spawnDepth - 1, depth + 1); });
+			right = emit(result, split, end, spawnDepth - 1, depth + 1);
+			worker.join();
+		}
+		else {
+			left = emit(result, start, split, 0, depth + 1);
+			right = emit(result, split, end, 0, depth + 1);
+		}
+
+		BVHBuildNode& parent = result.nodes[id];
+		parent.children[0] = left;
+		parent.children[1] = right;
+		parent.bounds = result.nodes[left].bounds;
+		parent.bounds.expand(result.nodes[right].bounds);
+		if (parent.axis < 0) parent.axis = parent.bounds.maxExtent();
+		_cost[id] = parent.bounds.surfaceArea() + _cost[left] + _cost[right];
+		_height[id] = 1 + std::max(_height[left], _height[right]);
+
+		if (_optimize) restructure(result, id, depth);
+		return id;
+	}
+
+	// 以 id 为根取 TREELET_SIZE 个叶子组成 treelet，枚举全部子集求 SAH 最优拓扑后原地重建。
+	// 子树在此之前已经优化完毕，因此整体相当于一次自底向上的优化。会使子树高度超出深度上限的拓扑不予采用
+	void restructure(BVHBuildResult& result, int id, int depth) {
+		std::vector<BVHBuildNode>& nodes = result.nodes;
+		int leaves[TREELET_SIZE];
+		int internals[TREELET_SIZE - 1];
+		int leafCount = 0, internalCount = 0;
+		internals[internalCount++] = id;
+		leaves[leafCount++] = nodes[id].children[0];
+		leaves[leafCount++] = nodes[id].children[1];
+		while (leafCount < TREELET_SIZE) {
+			int best = -1;
+			float bestArea = -1.0f;
+			for (int i = 0; i < leafCount; i++) {
+				const BVHBuildNode& leaf = nodes[leaves[i]];
+				if (leaf.count > 0) continue;
+				float area = leaf.bounds.surfaceArea();
+				if (area > bestArea) {
+					bestArea = area;
+					best = i;
+				}
+			}
+			if (best < 0) break;
+			int expanded = leaves[best];
+			internals[internalCount++] = expanded;
+			leaves[best] = nodes[expanded].children[0];
+			leaves[leafCount++] = nodes[expanded].children[1];
+		}
+		if (leafCount < 3) return;
+
+		const int subsets = 1 << leafCount;
+		float area[1 << TREELET_SIZE];
+		float best[1 << TREELET_SIZE];
+		int partition[1 << TREELET_SIZE];
+		for (int s = 1; s < subsets; s++) {
+			AABB box;
+			for (int i = 0; i < leafCount; i++) {
+				if (s & (1 << i)) box.expand(nodes[leaves[i]].bounds);
+			}
+			area[s] = box.surfaceArea();
+		}
+		for (int i = 0; i < leafCount; i++) best[1 << i] = _cost[leaves[i]];
+
+		// 按子集大小递增求最优代价，只枚举包含最低位的划分以去掉对称情况
+		for (int size = 2; size <= leafCount; size++) {
+			for (int s = 1; s < subsets; s++) {
+				if (popCount(s) != size) continue;
+				int low = s & -s;
+				float cost = std::numeric_limits<float>::infinity();
+				int bestPart = 0;
+				for (int p = (s - 1) & s; p > 0; p = (p - 1) & s) {
+					if (!(p & low)) continue;
+					float c = best[p] + best[s ^ p];
+					if (c < cost) {
+						cost = c;
+						bestPart = p;
+					}
+				}
+				best[s] = area[s] + cost;
+				partition[s] = bestPart;
+			}
+		}
+
+		int full = subsets - 1;
+		if (best[full] >= _cost[id] * 0.9999f) return;
+		if (treeletHeight(full, leaves, partition) > BVH::MAX_DEPTH - 1 - depth) return;
+		int next = 0;
+		rebuild(nodes, full, leaves, internals, next, partition);
+	}
+
+	int rebuild(std::vector<BVHBuildNode>& nodes, int subset, const int* leaves,
+		const int* internals, int& next, const int* partition) {
+		if (popCount(subset) == 1) return leaves[lowestBit(subset)];
+		int id = internals[next++];
+		int left = rebuild(nodes, partition[subset], leaves, internals, next, partition);
+		int right = rebuild(nodes, subset ^ partition[subset], leaves, internals, next, partition);
+
+		BVHBuildNode& node = nodes[id];
+		node.children[0] = left;
+		node.children[1] = right;
+		node.start = 0;
+		node.count = 0;
+		node.bounds = nodes[left].bounds;
+		node.bounds.expand(nodes[right].bounds);
+		glm::vec3 d = glm::abs(nodes[left].bounds.centroid() - nodes[right].bounds.centroid());
+		node.axis = d.x > d.y && d.x > d.z ? 0 : (d.y > d.z ? 1 : 2);
+		_cost[id] = node.bounds.surfaceArea() + _cost[left] + _cost[right];
+		_height[id] = 1 + std::max(_height[left], _height[right]);
+		return id;
+	}
+
+	// 按 partition 重建后 subset 对应子树的高度
+	int treeletHeight(int subset, const int* leaves, const int* partition) const {
+		if (popCount(subset) == 1) return _height[leaves[lowestBit(subset)]];
+		return 1 + std::max(treeletHeight(partition[subset], leaves, partition),
+			treeletHeight(subset ^ partition[subset], leaves, partition));
+	}
+
+	static int popCount(int v) {
+		int n = 0;
+		for (; v != 0; v &= v - 1) n++;
+		return n;
+	}
+
+	static int lowestBit(int v) {
+		int i = 0;
+		while (!(v & (1 << i))) i++;
+		return i;
+	}
+
+	int _threads;
+	bool _optimize;
+	int _leafSize;
+	std::vector<AABB> _bounds;
+	std::vector<uint32_t> _codes;
+	std::vector<float> _cost;
+	std::vector<int> _height;	// 子树的高度，叶子为 0
+	std::atomic<int> _nodeCount;
+};
+
+#endif // !LBVH_H
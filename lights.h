@@ -0,0 +1,295 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "ray.h"
+#include "aabb.h"
+#include "material.h"
+#include "bvh.h"
+#include "aligned.h"
+
+// 球形光源：取自场景中材质为 Emissive 的球体，prim 为其在 BVH 叶子顺序中的下标
+struct SphereLight {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 radiance;
+	int prim;
+};
+
+// 光源采样的结果：指向光源的单位方向、沿该方向到光源表面的距离、辐亮度与立体角概率密度（已含选中该光源的概率）
+struct LightSample {
+	glm::vec3 direction;
+	float distance;
+	glm::vec3 radiance;
+	float pdf;
+	int prim;
+};
+
+// 以 n 为 z 轴的正交基（Duff 等人的无分支构造）
+inline void orthonormalBasis(const glm::vec3& n, glm::vec3& b1, glm::vec3& b2) {
+	float sign = std::copysign(1.0f, n.z);
+	float a = -1.0f / (sign + n.z);
+	float b = n.x * n.y * a;
+	b1 = glm::vec3(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	b2 = glm::vec3(b, sign + n.y * n.y * a, -n.y);
+}
+
+// 从 point 看球 (center, radius) 所张圆锥的立体角，point 在球内时返回 0。
+// 1 - cosθmax 写成 sin²θmax / (1 + cosθmax)，小而远的光源也不会因相减而损失精度
+inline float sphereSolidAngle(const glm::vec3& point, const glm::vec3& center, float radius) {
+	glm::vec3 w = center - point;
+	float dist2 = glm::dot(w, w);
+	float sin2 = radius * radius / dist2;
+	if (sin2 >= 1.0f) return 0.0f;
+	return 2.0f * PI * sin2 / (1.0f + std::sqrt(1.0f - sin2));
+}
+
+// 光源层次结构的节点：子树内光源的包围盒与总功率，深度优先排列，左子节点紧跟在父节点之后。
+// offset 对内部节点为右子节点下标，对叶子为 -(光源下标 + 1)；每个叶子恰好一个光源
+struct alignas(32) LightBVHNode {
+	glm::vec3 min;
+	float power;
+	glm::vec3 max;
+	int offset;
+};
+static_assert(sizeof(LightBVHNode) == 32, "LightBVHNode must be 32 bytes");
+
+// 场景中的全部光源。沿光源层次结构（light BVH）逐层下行选出一个光源：每个内部节点按两个子节点对着色点的
+// 重要性（功率、距离与相对表面法线的朝向）随机选一侧，选中概率接近光源的实际贡献，耗时 O(log L)。
+// 再在所选光源所张的圆锥内按立体角均匀采样方向。球形光源向所有方向发光，节点不需要保存发光方向锥
+class LightSet {
+public:
+	static constexpr int SPLIT_BINS = 12;
+	static constexpr int SAH_DEPTH = 32;	// 更深的节点改用中位数划分，保证路径能放进 64 位的 trail
+
+	LightSet() = default;
+
+	// 扫描 BVH 中的球体，收集发光球体并构建层次结构
+	explicit LightSet(const BVH& bvh) {
+		const SphereSoA& spheres = bvh.spheres();
+		_index.assign(spheres.size(), -1);
+		for (int i = 0; i < spheres.size(); i++) {
+			Material* material = bvh.material(i);
+			if (material->kind() != MaterialKind::Emissive) continue;
+			_index[i] = int(_lights.size());
+			_lights.push_back(SphereLight{ spheres.center(i), spheres.radius(i),
+				static_cast<Emissive*>(material)->radiance(), i });
+		}
+		if (_lights.empty()) return;
+
+		std::vector<int> order(_lights.size());
+		for (size_t i = 0; i < order.size(); i++) order[i] = int(i);
+		_trail.resize(_lights.size());
+		_nodes.reserve(2 * _lights.size() - 1);
+		build(order, 0, int(order.size()), 0, 0);
+	}
+
+	bool empty() const { return _lights.empty(); }
+	int size() const { return int(_lights.size()); }
+	const SphereLight& light(int i) const { return _lights[i]; }
+	const AlignedVector<LightBVHNode>& nodes() const { return _nodes; }
+
+	// 为位于 point、法线为 normal 的漫反射表面采样光源：u 沿层次结构选择光源，u2 在圆锥内取方向。
+	// 光源全在表面背后、point 在所选光源内部或方向因舍入擦过球面时返回 false
+	bool sample(const glm::vec3& point, const glm::vec3& normal, float u, const glm::vec2& u2,
+		LightSample& result) const {
+		if (_lights.empty()) return false;
+		float pmf = 1.0f;
+		int current = 0;
+		while (_nodes[current].offset >= 0) {
+			int left = current + 1, right = _nodes[current].offset;
+			float wl = importance(_nodes[left], point, normal);
+			float wr = importance(_nodes[right], point, normal);
+			if (wl + wr <= 0.0f) return false;
+			// 选中一侧后把 u 重新映射回 [0, 1)（0.99999994 为小于 1 的最大 float），每一层复用同一个随机数
+			float pl = wl / (wl + wr);
+			if (u < pl) {
+				u = std::min(u / pl, 0.99999994f);
+				pmf *= pl;
+				current = left;
+			}
+			else {
+				u = std::min((u - pl) / (1.0f - pl), 0.99999994f);
+				pmf *= 1.0f - pl;
+				current = right;
+			}
+		}
+		if (importance(_nodes[current], point, normal) <= 0.0f) return false;
+
+		const SphereLight& light = _lights[-_nodes[current].offset - 1];
+		float solidAngle = sphereSolidAngle(point, light.center, light.radius);
+		if (solidAngle <= 0.0f) return false;
+
+		glm::vec3 w = glm::normalize(light.center - point);
+		glm::vec3 b1, b2;
+		orthonormalBasis(w, b1, b2);
+		float cosTheta = 1.0f - u2.x * solidAngle / (2.0f * PI);
+		float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+		float phi = 2.0f * PI * u2.y;
+		result.direction = glm::normalize(sinTheta * std::cos(phi) * b1 + sinTheta * std::sin(phi) * b2 + cosTheta * w);
+		result.distance = Sphere::rayCollision(light.center, light.radius, Ray::fromDirection(point, result.direction));
+		if (result.distance <= 0.0f) return false;
+		result.radiance = light.radiance;
+		result.pdf = pmf / solidAngle;
+		result.prim = light.prim;
+		return true;
+	}
+
+	// 从 (point, normal) 出发的方向恰好击中光源 prim 时，sample() 产生该方向的概率密度。
+	// 沿构建时记下的路径从根走到该光源的叶子，重算每一层的选择概率
+	float pdf(const glm::vec3& point, const glm::vec3& normal, int prim) const {
+		int index = prim >= 0 && prim < int(_index.size()) ? _index[prim] : -1;
+		if (index < 0) return 0.0f;
+		const SphereLight& light = _lights[index];
+		float solidAngle = sphereSolidAngle(point, light.center, light.radius);
+		if (solidAngle <= 0.0f) return 0.0f;
+
+		uint64_t trail = _trail[index];
+		float pmf = 1.0f;
+		int current = 0;
+		while (_nodes[current].offset >= 0) {
+			int left = current + 1, right = _nodes[current].offset;
+			float wl = importance(_nodes[left], point, normal);
+			float wr = importance(_nodes[right], point, normal);
+			if (wl + wr <= 0.0f) return 0.0f;
+			bool goRight = (trail & 1) != 0;
+			pmf *= (goRight ? wr : wl) / (wl + wr);
+			current = goRight ? right : left;
+			trail >>= 1;
+		}
+		if (importance(_nodes[current], point, normal) <= 0.0f) return 0.0f;
+		return pmf / solidAngle;
+	}
+
+private:
+	// 节点对着色点的重要性：功率除以到包围盒中心的距离平方，乘以法线与中心方向的夹角减去包围球张角后的余弦。
+	// 距离平方不小于包围球半径（半对角线）平方的 1/16，着色点靠近节点中心时权重不会发散；下限取整个半径平方
+	// 时，包含着色点的大节点内各子节点的权重几乎只剩功率，选择变得接近均匀。
+	// 着色点在包围球内时余弦取 1，整个包围球都在表面背后时为 0
+	static float importance(const LightBVHNode& node, const glm::vec3& point, const glm::vec3& normal) {
+		glm::vec3 w = 0.5f * (node.min + node.max) - point;
+		float radius2 = 0.25f * glm::dot(node.max - node.min, node.max - node.min);
+		float dist2 = glm::dot(w, w);
+		float falloff = node.power / std::max(dist2, radius2 / 16.0f);
+		if (dist2 <= radius2) return falloff;
+
+		float cosI = glm::dot(normal, w) / std::sqrt(dist2);
+		float sinI = std::sqrt(std::max(0.0f, 1.0f - cosI * cosI));
+		float sinB2 = radius2 / dist2;
+		float cosB = std::sqrt(1.0f - sinB2), sinB = std::sqrt(sinB2);
+		// cos(max(θi - θb, 0))
+		float cosClamped = cosI > cosB ? 1.0f : cosI * cosB + sinI * sinB;
+		return cosClamped <= 0.0f ? 0.0f : falloff * cosClamped;
+	}
+
+	// 球形光源的辐射功率 πL·4πr²（取三个通道的平均）
+	static float power(const SphereLight& light) {
+		float luminance = (light.radiance.x + light.radiance.y + light.radiance.z) / 3.0f;
+		return 4.0f * PI * PI * light.radius * light.radius * luminance;
+	}
+
+	static AABB bounds(const SphereLight& light) {
+		return AABB(light.center - glm::vec3(light.radius), light.center + glm::vec3(light.radius));
+	}
+
+	// 与几何 BVH 一样按质心最长轴分桶划分，代价取两侧的 功率 × 表面积 之和。
+	// trail 的第 depth 位记录从根到当前节点在该层是否走右侧，叶子处存入 _trail
+	int build(std::vector<int>& order, int start, int end, int depth, uint64_t trail) {
+		int id = int(_nodes.size());
+		_nodes.push_back(LightBVHNode());
+		AABB box, centroids;
+		float total = 0.0f;
+		for (int i = start; i < end; i++) {
+			const SphereLight& light = _lights[order[i]];
+			box.expand(bounds(light));
+			centroids.expand(light.center);
+			total += power(light);
+		}
+		_nodes[id].min = box.min();
+		_nodes[id].max = box.max();
+		_nodes[id].power = total;
+
+		if (end - start == 1) {
+			_nodes[id].offset = -(order[start] + 1);
+			_trail[order[start]] = trail;
+			return id;
+		}
+
+		int axis = centroids.maxExtent();
+		float lo = centroids.min()[axis], hi = centroids.max()[axis];
+		int split = -1;
+		if (hi > lo && depth < SAH_DEPTH) {
+			AABB binBox[SPLIT_BINS];
+			float binPower[SPLIT_BINS] = {};
+			int binCount[SPLIT_BINS] = {};
+			float scale = SPLIT_BINS / (hi - lo);
+			auto binOf = [&](int light) {
+				return std::min(int((_lights[light].center[axis] - lo) * scale), SPLIT_BINS - 1);
+			};
+			for (int i = start; i < end; i++) {
+				int b = binOf(order[i]);
+				binBox[b].expand(bounds(_lights[order[i]]));
+				binPower[b] += power(_lights[order[i]]);
+				binCount[b]++;
+			}
+
+			float bestCost = std::numeric_limits<float>::infinity();
+			int bestBin = -1;
+			for (int b = 1; b < SPLIT_BINS; b++) {
+				AABB left, right;
+				float leftPower = 0.0f, rightPower = 0.0f;
+				int leftCount = 0, rightCount = 0;
+				for (int k = 0; k < b; k++) {
+					left.expand(binBox[k]);
+					leftPower += binPower[k];
+					leftCount += binCount[k];
+				}
+				for (int k = b; k < SPLIT_BINS; k++) {
+					right.expand(binBox[k]);
+					rightPower += binPower[k];
+					rightCount += binCount[k];
+				}
+				if (leftCount == 0 || rightCount == 0) continue;
+				float cost = leftPower * left.surfaceArea() + rightPower * right.surfaceArea();
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestBin = b;
+				}
+			}
+			if (bestBin > 0) {
+				auto mid = std::partition(order.begin() + start, order.begin() + end,
+					[&](int light) { return binOf(light) < bestBin; });
+				split = int(mid - order.begin());
+			}
+		}
+		if (split < 0) {
+			split = start + (end - start) / 2;
+			std::nth_element(order.begin() + start, order.begin() + split, order.begin() + end,
+				[&](int a, int b) { return _lights[a].center[axis] < _lights[b].center[axis]; });
+		}
+
+		build(order, start, split, depth + 1, trail);
+		_nodes[id].offset = build(order, split, end, depth + 1, trail | (uint64_t(1) << depth));
+		return id;
+	}
+
+	std::vector<SphereLight> _lights;
+	std::vector<int> _index;				// 球体下标到光源下标，不发光的球体为 -1
+	AlignedVector<LightBVHNode> _nodes;
+	std::vector<uint64_t> _trail;			// 每个光源从根到叶子的左右选择，第 k 位对应第 k 层
+};
+
+// 多重重要性采样的幂启发式（β = 2），返回以 pdf 采样的一方的权重
+inline float powerHeuristic(float pdf, float otherPdf) {
+	float a = pdf * pdf, b = otherPdf * otherPdf;
+	return a + b > 0.0f ? a / (a + b) : 0.0f;
+}
+
+#endif // !LIGHTS_H
@@ -5,64 +5,76 @@
 #include <random>
 #include <vector>
 #include <cmath>
-#include <fstream>
+#include <utility>
 #include <string>
-
-#include "shader.h"
-#include "camera.h"
-#include "material.h"
-#include "ray.h"
-#include "sphere.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "display.h"
+#include "scene.h"
+#include "renderer.h"
+#include "benchmark.h"
+#include "self_test.h"
+#include "output.h"
+#include "config.h"
+#include "scene_loader.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 
-const unsigned int SCR_WIDTH = 1200;
-const unsigned int SCR_HEIGHT = 800;
-constexpr int MAX_RECURSION_TIME = 10;
-constexpr int SAMPLE_PER_PIXEL = 100;
-glm::vec3 col[SCR_WIDTH][SCR_HEIGHT];
+constexpr double DISPLAY_FPS = 30.0;
 
 void vecPrint(glm::vec3 v) {
     std::cout << v.x << " " << v.y << " " << v.z << std::endl;
 }
 
-glm::vec3 color(const Ray& ray, Sphere** world, int length, int depth) {
-    float minT = FLOAT_INF;
-    Sphere* collidedSphere = nullptr;
-    for (int i = 0; i < length; i++) {
-        float t = world[i]->rayCollision(ray);
-        if (t > FLOAT_EPS && t < minT) {
-            minT = t;
-            collidedSphere = world[i];
-        }
+int main(int argc, char** argv) {
+    // 交互模式默认每 10 轮写出一张中间结果，命令行与配置文件可以覆盖
+    RenderConfig defaults;
+    defaults.output.mode = OutputPolicy::Mode::EverySamples;
+    defaults.output.everySamples = 10;
+    RenderConfig config = defaults;
+    std::string error;
+    if (!parseCommandLine(argc, argv, config, error)) {
+        std::cout << error << std::endl;
+        printConfigUsage(std::cout, argv[0]);
+        return -1;
     }
-   
-    if (collidedSphere != nullptr) {
-        if (depth < MAX_RECURSION_TIME) {
-            auto ret = collidedSphere->material()->scatter(ray, collidedSphere, minT);
-            auto r = ret.first;
-            auto c = ret.second;
-
-            glm::vec3 result(0.0f);
-            for (int i = 0; i < r.size(); i++) {
-                result += c[i] * color(r[i], world, length, depth + 1);
-            }
-            //vecPrint(result);
-            return result;
-        }
-        else {
-            return glm::vec3(0.0f);
-        }
+    if (config.help) {
+        printConfigUsage(std::cout, argv[0]);
+        return 0;
     }
-    else {
-        if (ray.direction().y != ray.direction().y) return glm::vec3(0.0f);
-        float t = 0.5f * (ray.direction().y + 1.0f);
-        return (1.0f - t) * glm::vec3(1.0f, 1.0f, 1.0f) + t * glm::vec3(0.5f, 0.7f, 1.0f);
+    // 仅运行 BVH 构建时间基准
+    if (config.benchBuild) {
+        benchmarkBuild(std::cout);
+        return 0;
     }
-}
+    // 仅运行自检，比对向量内核与 BVH 遍历的结果
+    if (config.selfTest) {
+        return runSelfTest(std::cout) ? 0 : -1;
+    }
+    // 场景文件中的渲染设置会影响分辨率，须在创建窗口之前加载
+    std::unique_ptr<Scene> scene = prepareScene(argc, argv, defaults, config, error);
+    if (!scene) {
+        std::cout << error << std::endl;
+        return -1;
+    }
+    // 只生成场景缓存，供之后的渲染任务直接映射使用
+    if (!config.writeCache.empty()) {
+        if (!writeSceneCache(config.writeCache, *scene, config.builder, config.threads, error)) {
+            std::cout << error << std::endl;
+            return -1;
+        }
+        std::cout << "WROTE SCENE CACHE: " << config.writeCache << std::endl;
+        return 0;
+    }
+    const int width = config.width;
+    const int height = config.height;
+    const int samples = config.samples;
+    const OutputPolicy& output = config.output;
 
-int main() {
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -72,7 +84,7 @@ int main() {
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "RayTracing", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(width, height, "RayTracing", NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -88,118 +100,96 @@ int main() {
         return -1;
     }
 
-    // 初始化随机数生成器
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> distribution(0.0, 1.0);
-
-    // 初始化顶点和片元着色器
-    Shader shader("shader.vs", "shader.fs");
-
-    // 这里只是一个象征性的VAO和VBO初始化，实际上没有用到渲染管线的特点
-    float point[] = { 0, 0, 0 };
-    GLuint VAO, VBO;
-
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(point), point, GL_STATIC_DRAW);
-
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // 随机场景
-    int n = 500;
-    Sphere** world = new Sphere * [n];
-    world[0] = new Sphere(glm::vec3(0.0f, -1000.0f, 0.0f), 1000.0f,
-        new Lambertian(glm::vec3(0.5f, 0.5f, 0.5f)));
-    int cnt = 1;
-    for (int a = -11; a < 11; a++) {
-        for (int b = -11; b < 11; b++) {
-            float choose_mat = distribution(gen);
-            glm::vec3 center(a + 0.9f * distribution(gen), 0.2f, b + 0.9f * distribution(gen));
-            auto tmp = center - glm::vec3(4.0f, 0.2f, 0.0f);
-            if (std::sqrt(glm::dot(tmp, tmp)) > 0.9f) {
-                if (choose_mat < 0.8f) { // diffuse
-                    world[cnt++] = new Sphere(center, 0.2, new Lambertian(glm::vec3(distribution(gen) * distribution(gen), 
-                        distribution(gen) * distribution(gen), distribution(gen) * distribution(gen))));
-                }
-                else if (choose_mat < 0.95f) { // metal
-                    world[cnt++] = new Sphere(center, 0.2, new Metal(glm::vec3(0.5f * (1.0f + distribution(gen)),
-                        0.5f * (1.0f + distribution(gen)), 0.5f * (1.0f + distribution(gen)))));
-                }
-                else // glass
-                {
-                    world[cnt++] = new Sphere(center, 0.2f, new Dielectric(1.5f));
-                }
+    // 整帧纹理上传与全屏绘制
+    Display display(width, height);
+    std::cout << "PERSISTENT PBO: " << (display.persistent() ? "yes" : "no") << std::endl;
+
+    // 渲染核心负责构建加速结构与多线程采样
+    Renderer renderer(*scene, width, height, config.tileSize, config.threads,
+        Sampler(config.seed, config.sampler, samples), config.builder);
+    renderer.setSettings(config.integrator);
+    std::cout << "BVH WIDTH: " << renderer.bvh().width() << std::endl;
+    std::cout << "RENDER THREADS: " << renderer.threads() << std::endl;
+
+    // 追踪线程逐轮采样，每轮结束后把结果发布到共享缓冲；主线程只负责显示
+    std::vector<float> published(size_t(width) * height * 3, 0.0f);
+    std::vector<float> frame(published.size());
+    std::mutex publishMutex;
+    int publishedVersion = 0;
+    std::atomic<bool> stop(false);
+    std::atomic<bool> finished(false);
+
+    // 按输出策略写出中间结果，结束时写出最终结果，编码与写盘都在后台线程
+    ImageWriter writer;
+    auto lastWrite = std::chrono::steady_clock::now();
+
+    std::thread tracer([&]() {
+        int sample = 0;
+        while (sample < samples && !stop && !renderer.converged()) {
+            sample++;
+            std::cout << "SAMPLE TIMES: " << sample << std::endl;
+            renderer.renderSample();
+            {
+                std::lock_guard<std::mutex> lock(publishMutex);
+                renderer.copyPixels(published.data());
+                publishedVersion++;
             }
-        }
-    }
-
-    world[cnt++] = new Sphere(glm::vec3(6.0f, 1.0f, 0.0f), 1.0f, new Metal(glm::vec3(0.7f, 0.6f, 0.5f)));
-    world[cnt++] = new Sphere(glm::vec3(2.0f, 1.0f, 0.0f), 1.0f, new Dielectric(1.5f));
-    //world[cnt++] = new Sphere(glm::vec3(2.0f, 1.0f, 0.0f), 0.8f, new Dielectric(1.5f));
-    world[cnt++] = new Sphere(glm::vec3(-2.0f, 1.0f, 0.0f), 1.0f, new Lambertian(glm::vec3(0.4f, 0.2f, 0.1f)));
-
-    // 观察点
-    glm::vec3 lookfrom(13.0f, 2.0f, 3.0f);
-    glm::vec3 lookat(0.0f, 0.0f, 0.0f);
-
-    Camera cam(lookfrom, lookat, glm::vec3(0.0f, 1.0f, 0.0f), 20.0f, float(SCR_WIDTH) / float(SCR_HEIGHT));
-
-    // 主循环渲染画面
-    std::string prefix("image_");
-    std::string ext(".ppm");
-    for (int sample = 1; sample <= SAMPLE_PER_PIXEL; sample++) {
-        std::cout << "SAMPLE TIMES: " << sample << std::endl;
-        std::string filename = prefix + std::to_string(sample) + ext;
-        std::ofstream of(filename);
-        of << "P3\n" << SCR_WIDTH << " " << SCR_HEIGHT << "\n255\n";
-        if (!glfwWindowShouldClose(window)) {
-            // 处理输入信息
-            processInput(window);
-
-            // 初始化颜色缓冲（随便找个颜色，其实只有刷新的作用）
-            glClearColor(0.529f, 0.808f, 0.922f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            // 将点设置为绘制对象
-            shader.use();
-            glBindVertexArray(VAO);
-
-            // 枚举屏幕上每一个像素
-            for (int j = SCR_HEIGHT - 1; j >= 0; j--) {
-                for (int i = 0; i < SCR_WIDTH; i++) {
-                    glm::vec2 pos(float(i) * 2.0f / SCR_WIDTH - 1.0f, float(j) * 2.0f / SCR_HEIGHT - 1.0f);
-                    shader.setVec2("screenPos", pos.x, pos.y);
-
-                    float u = float(i + distribution(gen)) / float(SCR_WIDTH);
-                    float v = float(j + distribution(gen)) / float(SCR_HEIGHT);
-                    Ray r = cam.get_ray(u, v);
-
-                    glm::vec3 c = color(r, world, cnt, 0);
-                    c = glm::vec3(std::sqrt(c[0]), std::sqrt(c[1]), std::sqrt(c[2]));
-                    col[i][j] = col[i][j] * float(sample - 1) / float(sample) + c / float(sample);
-                    of << int(255.99f * col[i][j].x) << " " << int(255.99f * col[i][j].y) << " " << int(255.99f * col[i][j].z) << "\n";
-                    
-                    shader.setVec3("vertexColor", col[i][j]);
-                    glDrawArrays(GL_POINTS, 0, 1);
-                }
+            auto now = std::chrono::steady_clock::now();
+            if (sample < samples && output.due(sample, std::chrono::duration<double>(now - lastWrite).count())) {
+                std::vector<float> snapshot(size_t(width) * height * 3);
+                renderer.copyLinear(snapshot.data());
+                writer.submit(std::move(snapshot), width, height, output.intermediatePath(sample));
+                lastWrite = now;
             }
-
-            // 双缓冲
-            glfwSwapBuffers(window);
-            glfwPollEvents();
         }
-        else {
-            break;
+        std::vector<float> snapshot(size_t(width) * height * 3);
+        renderer.copyLinear(snapshot.data());
+        writer.submit(std::move(snapshot), width, height, output.path);
+        if (!config.sampleMap.empty()) {
+            std::vector<float> counts(size_t(width) * height * 3);
+            renderer.copySampleCounts(counts.data(), imageFormatFromPath(config.sampleMap) != ImageFormat::PFM);
+            writer.submit(std::move(counts), width, height, config.sampleMap);
         }
-        of.close();
-    } 
+        finished = true;
+    });
+
+    // 主循环以限定的帧率刷新画面
+    auto frameTime = std::chrono::duration<double>(1.0 / DISPLAY_FPS);
+    int displayedVersion = 0;
+    while (!glfwWindowShouldClose(window)) {
+        auto frameStart = std::chrono::steady_clock::now();
+        bool done = finished;
+
+        // 处理输入信息
+        processInput(window);
+
+        bool updated = false;
+        {
+            std::lock_guard<std::mutex> lock(publishMutex);
+            if (publishedVersion != displayedVersion) {
+                // 追踪线程每次发布都会整体覆盖缓冲，交换即可取走最新一帧
+                frame.swap(published);
+                displayedVersion = publishedVersion;
+                updated = true;
+            }
+        }
+        if (updated) display.upload(frame.data());
+
+        glClearColor(0.529f, 0.808f, 0.922f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        display.draw();
+
+        // 双缓冲
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+
+        if (done && !updated) break;
+        std::this_thread::sleep_until(frameStart + frameTime);
+    }
 
-    delete[] world;
+    stop = true;
+    tracer.join();
+    writer.flush();
     glfwTerminate();
     return 0;
 }
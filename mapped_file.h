@@ -0,0 +1,105 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 只读内存映射的文件。映射后不读入任何数据，页面在首次访问时由系统按需调入
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path, std::string& error) {
+		close();
+#ifdef _WIN32
+		_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (_file == INVALID_HANDLE_VALUE) {
+			error = "failed to open " + path;
+			return false;
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+			error = "failed to map empty file " + path;
+			close();
+			return false;
+		}
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping != nullptr) _data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (_data == nullptr) {
+			error = "failed to map " + path;
+			close();
+			return false;
+		}
+		_size = size_t(size.QuadPart);
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			error = "failed to open " + path;
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			error = "failed to map empty file " + path;
+			::close(fd);
+			return false;
+		}
+		void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (data == MAP_FAILED) {
+			error = "failed to map " + path;
+			return false;
+		}
+		_data = data;
+		_size = size_t(st.st_size);
+#endif
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		if (_data != nullptr) UnmapViewOfFile(_data);
+		if (_mapping != nullptr) CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+		_mapping = nullptr;
+		_file = INVALID_HANDLE_VALUE;
+#else
+		if (_data != nullptr) munmap(_data, _size);
+#endif
+		_data = nullptr;
+		_size = 0;
+	}
+
+	// 映射的首地址按页对齐
+	const unsigned char* data() const { return static_cast<const unsigned char*>(_data); }
+	size_t size() const { return _size; }
+
+private:
+	void* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#endif
+};
+
+#endif // !MAPPED_FILE_H
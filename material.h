@@ -5,87 +5,112 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include <vector>
-#include <random>
 #include <cmath>
+#include <algorithm>
 
 #include "ray.h"
-#include "sphere.h"
+#include "sampler.h"
 
-class Sphere;
+// 一次散射产生的出射光线及其衰减，容量固定、存放在栈上，散射过程不做任何堆分配
+struct ScatterRecord {
+	static constexpr int MAX_RAYS = 2;
 
+	void push(const Ray& ray, const glm::vec3& attenuation) {
+		rays[count] = ray;
+		attenuations[count] = attenuation;
+		count++;
+	}
+
+	int count = 0;
+	Ray rays[MAX_RAYS];
+	glm::vec3 attenuations[MAX_RAYS];
+	// 漫反射材质采样方向的立体角概率密度，供多重重要性采样使用；镜面反射与折射（δ 分布）为 0
+	float pdf = 0.0f;
+};
+
+// 材质的具体类型，波前积分器据此把命中点分组，对同类材质成批着色
+enum class MaterialKind {
+	Lambertian,
+	Metal,
+	Dielectric,
+	Emissive,
+	Count
+};
+
+// 材质分配在场景的内存池中，随场景整体释放，从不通过基类指针 delete，因此析构函数不是虚函数，
+// 各派生类保持平凡析构
 class Material {
 public:
-	virtual std::pair<std::vector<Ray>, std::vector<glm::vec3>> scatter(
-		const Ray& r_in, Sphere* hitSphere, float t) = 0;
+	explicit Material(MaterialKind kind) : _kind(kind) {}
+
+	MaterialKind kind() const { return _kind; }
+	// center 为命中球体的球心，法线由它与命中点求出
+	virtual ScatterRecord scatter(const Ray& r_in, const glm::vec3& center, float t, Sampler& sampler) = 0;
+
+private:
+	MaterialKind _kind;
 };
 
 class Lambertian : public Material {
 public:
-	Lambertian(const glm::vec3 color) {
-		_color.push_back(color);
-	}
+	Lambertian(const glm::vec3 color) : Material(MaterialKind::Lambertian), _color(color) {}
+	glm::vec3 color() const { return _color; }
 
-	virtual std::pair<std::vector<Ray>, std::vector<glm::vec3>> scatter(
-		const Ray& r_in, Sphere* hitSphere, float t) {
-		std::vector<Ray> result;
-		std::vector<glm::vec3> color = _color;
+	virtual ScatterRecord scatter(const Ray& r_in, const glm::vec3& center, float t, Sampler& sampler) {
+		ScatterRecord result;
 		glm::vec3 hitPoint(r_in.origin() + t * r_in.direction());
-		glm::vec3 normal = glm::normalize(hitPoint - hitSphere->center());
-		glm::vec3 target = hitPoint + normal + randomInUnitSphere();
-		result.push_back(Ray(hitPoint, target));
-		return std::make_pair(result, color);
+		glm::vec3 normal = glm::normalize(hitPoint - center);
+		// 法线加单位球面上的均匀点即为余弦分布，衰减中 cos/π 与 pdf 相消后只剩反照率
+		glm::vec3 direction = normal + randomUnitVector(sampler);
+		if (glm::dot(direction, direction) < 1e-8f) direction = normal;
+		Ray scattered = Ray::fromDirection(hitPoint, glm::normalize(direction));
+		result.push(scattered, _color);
+		result.pdf = std::max(glm::dot(normal, scattered.direction()), 0.0f) / PI;
+		return result;
 	}
 
+	// BRDF 值，与入射、出射方向无关
+	glm::vec3 evaluate() const { return _color / PI; }
+
 private:
-	glm::vec3 randomInUnitSphere() {
-		std::random_device rd;
-		std::mt19937 gen(rd());
-		std::uniform_real_distribution<float> distribution(0.0, 1.0);
-
-		glm::vec3 p;
-		do {
-			p = 2.0f * glm::vec3(distribution(gen), distribution(gen), distribution(gen)) \
-				- glm::vec3(1.0f, 1.0f, 1.0f);
-		} while (std::sqrt(glm::dot(p, p)) >= 1.0);
-		return p;
+	glm::vec3 randomUnitVector(Sampler& sampler) {
+		glm::vec2 u = sampler.get2D();
+		float z = 1.0f - 2.0f * u.x;
+		float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+		float phi = 2.0f * PI * u.y;
+		return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
 	}
 
-	std::vector<glm::vec3> _color;
+	glm::vec3 _color;
 };
 
 class Metal : public Material {
 public:
-	Metal(const glm::vec3 color) {
-		_color.push_back(color);
-	}
+	Metal(const glm::vec3 color) : Material(MaterialKind::Metal), _color(color) {}
+	glm::vec3 color() const { return _color; }
 
-	virtual std::pair<std::vector<Ray>, std::vector<glm::vec3>> scatter(
-		const Ray& r_in, Sphere* hitSphere, float t) {
-		std::vector<Ray> result;
-		std::vector<glm::vec3> color = _color;
+	virtual ScatterRecord scatter(const Ray& r_in, const glm::vec3& center, float t, Sampler& /*sampler*/) {
+		ScatterRecord result;
 		glm::vec3 hitPoint(r_in.origin() + t * r_in.direction());
-		glm::vec3 normal = glm::normalize(hitPoint - hitSphere->center());
+		glm::vec3 normal = glm::normalize(hitPoint - center);
 		glm::vec3 reflected = glm::reflect(r_in.direction(), normal);
-		result.push_back(Ray(hitPoint, hitPoint + reflected));
-		return std::make_pair(result, color);
+		result.push(Ray(hitPoint, hitPoint + reflected), _color);
+		return result;
 	}
 
 private:
-	std::vector<glm::vec3> _color;
+	glm::vec3 _color;
 };
 
 class Dielectric : public Material {
 public:
-	Dielectric(float reflectIdx) : _reflectIdx{ reflectIdx } {}
-	float reflectIdx() { return _reflectIdx; }
+	Dielectric(float reflectIdx) : Material(MaterialKind::Dielectric), _reflectIdx{ reflectIdx } {}
+	float reflectIdx() const { return _reflectIdx; }
 
-	virtual std::pair<std::vector<Ray>, std::vector<glm::vec3>> scatter(
-		const Ray& r_in, Sphere* hitSphere, float t) {
-		std::vector<Ray> result;
-		std::vector<glm::vec3> color;
+	virtual ScatterRecord scatter(const Ray& r_in, const glm::vec3& center, float t, Sampler& /*sampler*/) {
+		ScatterRecord result;
 		glm::vec3 hitPoint(r_in.origin() + t * r_in.direction());
-		glm::vec3 normal = glm::normalize(hitPoint - hitSphere->center());
+		glm::vec3 normal = glm::normalize(hitPoint - center);
 		float eta, cosine;
 
 		if (glm::dot(r_in.direction(), normal) > 0.0f) {
@@ -106,16 +131,13 @@ public:
 		glm::vec3 refracted = glm::refract(r_in.direction(), normal, eta);
 		if (refracted.x != refracted.x) {
 			// NaN
-			result.push_back(Ray(hitPoint, hitPoint + reflected));
-			color.push_back(glm::vec3(1.0f));
+			result.push(Ray(hitPoint, hitPoint + reflected), glm::vec3(1.0f));
 		}
 		else {
-			result.push_back(Ray(hitPoint, hitPoint + reflected));
-			color.push_back(glm::vec3(schlick(cosine)));
-			result.push_back(Ray(hitPoint, hitPoint + refracted));
-			color.push_back(glm::vec3(1 - schlick(cosine)));
+			result.push(Ray(hitPoint, hitPoint + reflected), glm::vec3(schlick(cosine)));
+			result.push(Ray(hitPoint, hitPoint + refracted), glm::vec3(1 - schlick(cosine)));
 		}
-		return std::make_pair(result, color);
+		return result;
 	}
 
 private:
@@ -128,4 +150,18 @@ private:
 	float _reflectIdx;
 };
 
+// 发光材质：向球外均匀地发出 radiance，不散射，路径在此终止
+class Emissive : public Material {
+public:
+	Emissive(const glm::vec3 radiance) : Material(MaterialKind::Emissive), _radiance(radiance) {}
+	glm::vec3 radiance() const { return _radiance; }
+
+	virtual ScatterRecord scatter(const Ray& /*r_in*/, const glm::vec3& /*center*/, float /*t*/, Sampler& /*sampler*/) {
+		return ScatterRecord();
+	}
+
+private:
+	glm::vec3 _radiance;
+};
+
 #endif // !MATERIAL_H
\ No newline at end of file
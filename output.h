@@ -0,0 +1,128 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+#include "image_io.h"
+
+// 渲染过程中何时写出图像
+struct OutputPolicy {
+	enum class Mode {
+		Final,			// 只在渲染结束时写出
+		EverySamples,	// 每 everySamples 轮采样写出一次
+		EverySeconds	// 距上次写出超过 everySeconds 秒后写出一次
+	};
+
+	Mode mode = Mode::Final;
+	int everySamples = 10;
+	double everySeconds = 10.0;
+	std::string path = "image.ppm";	// 最终结果的文件名，格式由扩展名决定
+
+	// 第 sample 轮结束时是否需要写出中间结果，elapsed 为距上次写出的秒数
+	bool due(int sample, double elapsed) const {
+		switch (mode) {
+		case Mode::EverySamples: return everySamples > 0 && sample % everySamples == 0;
+		case Mode::EverySeconds: return elapsed >= everySeconds;
+		default: return false;
+		}
+	}
+
+	// 中间结果的文件名：在扩展名前插入采样轮数，如 image_20.ppm
+	std::string intermediatePath(int sample) const {
+		std::string::size_type dot = path.find_last_of('.');
+		std::string::size_type slash = path.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+			return path + "_" + std::to_string(sample);
+		}
+		return path.substr(0, dot) + "_" + std::to_string(sample) + path.substr(dot);
+	}
+};
+
+// 后台写图线程：渲染线程提交一份缓冲快照后立即返回，编码与磁盘写入都在后台完成。
+// 快照按提交顺序排队写出、不会丢弃；排队的快照达到 MAX_PENDING 份时 submit 等待写图线程，
+// 以免写入跟不上时快照占用的内存无限增长
+class ImageWriter {
+public:
+	static constexpr int MAX_PENDING = 2;
+
+	ImageWriter() : _thread([this]() { run(); }) {}
+
+	~ImageWriter() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		_thread.join();
+	}
+
+	ImageWriter(const ImageWriter&) = delete;
+	ImageWriter& operator=(const ImageWriter&) = delete;
+
+	// rgb 为自下而上逐行排列的线性 RGB 快照，所有权转移给写图线程
+	void submit(std::vector<float>&& rgb, int width, int height, const std::string& path) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_idle.wait(lock, [this]() { return int(_queue.size()) < MAX_PENDING; });
+			_queue.emplace_back();
+			Job& job = _queue.back();
+			job.rgb.swap(rgb);
+			job.width = width;
+			job.height = height;
+			job.path = path;
+		}
+		_wake.notify_all();
+	}
+
+	// 等待已提交的快照全部写完
+	void flush() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_idle.wait(lock, [this]() { return _queue.empty() && !_busy; });
+	}
+
+private:
+	struct Job {
+		std::vector<float> rgb;
+		int width = 0;
+		int height = 0;
+		std::string path;
+	};
+
+	void run() {
+		Job job;
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true) {
+			_wake.wait(lock, [this]() { return !_queue.empty() || _stop; });
+			if (_queue.empty()) break;
+			std::swap(job, _queue.front());
+			_queue.pop_front();
+			_busy = true;
+			_idle.notify_all();
+			lock.unlock();
+
+			if (!writeImage(job.path, imageFormatFromPath(job.path), job.width, job.height, job.rgb.data())) {
+				std::cout << "Failed to write " << job.path << std::endl;
+			}
+
+			lock.lock();
+			_busy = false;
+			_idle.notify_all();
+		}
+	}
+
+	mutable std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _idle;	// 队列出现空位或全部写完
+	std::deque<Job> _queue;
+	bool _busy = false;
+	bool _stop = false;
+	std::thread _thread;
+};
+
+#endif // !OUTPUT_H
@@ -0,0 +1,197 @@
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "ray.h"
+#include "bvh.h"
+#include "simd.h"
+
+// 8 条光线组成的光线包（SoA），用于相干的主光线。active 的第 i 位表示第 i 条光线有效
+struct alignas(32) RayPacket {
+	static constexpr int SIZE = 8;
+
+	void set(int lane, const Ray& ray) {
+		glm::vec3 o = ray.origin(), d = ray.direction();
+		ox[lane] = o.x; oy[lane] = o.y; oz[lane] = o.z;
+		dx[lane] = d.x; dy[lane] = d.y; dz[lane] = d.z;
+		active |= 1 << lane;
+	}
+
+	// 无效车道保持为 0，不参与任何比较结果
+	float ox[SIZE] = {}, oy[SIZE] = {}, oz[SIZE] = {};
+	float dx[SIZE] = {}, dy[SIZE] = {}, dz[SIZE] = {};
+	float tMax[SIZE];	// 最近交点距离，未命中为 FLOAT_INF
+	int hit[SIZE];		// 命中球体在 BVH 叶子顺序中的下标，未命中为 -1
+	int active = 0;
+};
+
+// 以光线包遍历二叉 BVH：每个节点先用区间算术对整个包做保守的视锥剔除，
+// 未被剔除时再用 AVX2 同时对 8 条光线做 slab 测试；叶子中每个球体同时与 8 条光线求交。
+// 球体求交的运算顺序与 Sphere::rayCollision 相同，交点距离与单光线路径逐位一致
+class PacketTracer {
+public:
+	explicit PacketTracer(const BVH& bvh) : _bvh(bvh) {}
+
+	static bool supported() { return simdLevel() >= SimdLevel::AVX2; }
+
+	void intersect(RayPacket& packet) const {
+		for (int i = 0; i < RayPacket::SIZE; i++) {
+			packet.tMax[i] = FLOAT_INF;
+			packet.hit[i] = -1;
+		}
+		if (packet.active == 0 || _bvh.nodeCount() == 0) return;
+		intersect8(packet);
+	}
+
+private:
+	// 包内光线的原点与方向倒数在各轴上的取值区间
+	struct Interval {
+		float lo[3], hi[3];
+	};
+
+	static void intervalProduct(float aLo, float aHi, float bLo, float bHi, float& lo, float& hi) {
+		float p0 = aLo * bLo, p1 = aLo * bHi, p2 = aHi * bLo, p3 = aHi * bHi;
+		lo = std::min(std::min(p0, p1), std::min(p2, p3));
+		hi = std::max(std::max(p0, p1), std::max(p2, p3));
+	}
+
+	// 区间算术剔除：包内任一光线都不可能穿过该包围盒时返回 true
+	static bool culled(const LinearBVHNode& node, const Interval& origin, const Interval& invDir, float tMax) {
+		const float* bmin = &node.min.x;
+		const float* bmax = &node.max.x;
+		float enter = FLOAT_EPS, exit = tMax;
+		for (int a = 0; a < 3; a++) {
+			float lo0, hi0, lo1, hi1;
+			intervalProduct(bmin[a] - origin.hi[a], bmin[a] - origin.lo[a], invDir.lo[a], invDir.hi[a], lo0, hi0);
+			intervalProduct(bmax[a] - origin.hi[a], bmax[a] - origin.lo[a], invDir.lo[a], invDir.hi[a], lo1, hi1);
+			enter = std::max(enter, std::min(lo0, lo1));
+			exit = std::min(exit, std::max(hi0, hi1));
+		}
+		return enter > exit;
+	}
+
+	RT_TARGET_AVX2 void intersect8(RayPacket& p) const {
+		const LinearBVHNode* nodes = _bvh.nodes();
+		const SphereSoA& spheres = _bvh.spheres();
+
+		__m256 ox = _mm256_load_ps(p.ox), oy = _mm256_load_ps(p.oy), oz = _mm256_load_ps(p.oz);
+		__m256 dx = _mm256_load_ps(p.dx), dy = _mm256_load_ps(p.dy), dz = _mm256_load_ps(p.dz);
+		__m256 one = _mm256_set1_ps(1.0f);
+		__m256 ix = _mm256_div_ps(one, dx), iy = _mm256_div_ps(one, dy), iz = _mm256_div_ps(one, dz);
+		__m256 A = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		__m256 zero = _mm256_setzero_ps();
+		__m256 eps = _mm256_set1_ps(FLOAT_EPS), inf = _mm256_set1_ps(FLOAT_INF);
+		__m256 tMax = inf;
+		__m256i hit = _mm256_set1_epi32(-1);
+		__m256 laneActive = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+			_mm256_and_si256(_mm256_set1_epi32(p.active), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+			_mm256_setzero_si256()));
+
+		// 只有包内所有光线在某轴上方向同号时，方向倒数的区间才是有界的，否则不做区间剔除
+		alignas(32) float inv[3][RayPacket::SIZE];
+		_mm256_store_ps(inv[0], ix);
+		_mm256_store_ps(inv[1], iy);
+		_mm256_store_ps(inv[2], iz);
+		const float* org[3] = { p.ox, p.oy, p.oz };
+		Interval origin, invDir;
+		bool useInterval = true;
+		int first = 0;
+		while (!(p.active & (1 << first))) first++;
+		for (int a = 0; a < 3; a++) {
+			origin.lo[a] = origin.hi[a] = org[a][first];
+			invDir.lo[a] = invDir.hi[a] = inv[a][first];
+			for (int i = first + 1; i < RayPacket::SIZE; i++) {
+				if (!(p.active & (1 << i))) continue;
+				origin.lo[a] = std::min(origin.lo[a], org[a][i]);
+				origin.hi[a] = std::max(origin.hi[a], org[a][i]);
+				invDir.lo[a] = std::min(invDir.lo[a], inv[a][i]);
+				invDir.hi[a] = std::max(invDir.hi[a], inv[a][i]);
+			}
+			if ((invDir.lo[a] < 0.0f) != (invDir.hi[a] < 0.0f)) useInterval = false;
+		}
+		bool dirNeg[3] = { inv[0][first] < 0.0f, inv[1][first] < 0.0f, inv[2][first] < 0.0f };
+
+		alignas(32) float tLanes[RayPacket::SIZE];
+		int stack[BVH::MAX_DEPTH];
+		int top = 0;
+		int current = 0;
+		while (true) {
+			const LinearBVHNode& node = nodes[current];
+			_mm256_store_ps(tLanes, tMax);
+			float packetMax = *std::max_element(tLanes, tLanes + RayPacket::SIZE);
+
+			int mask = 0;
+			if (!useInterval || !culled(node, origin, invDir, packetMax)) {
+				__m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.min.x), ox), ix);
+				__m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.max.x), ox), ix);
+				__m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.min.y), oy), iy);
+				__m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.max.y), oy), iy);
+				__m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.min.z), oz), iz);
+				__m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(node.max.z), oz), iz);
+				__m256 enter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)),
+					_mm256_max_ps(_mm256_min_ps(t0z, t1z), eps));
+				__m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)),
+					_mm256_min_ps(_mm256_max_ps(t0z, t1z), tMax));
+				mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ), laneActive));
+			}
+
+			if (mask != 0) {
+				if (node.count > 0) {
+					__m256 leafLanes = _mm256_castsi256_ps(_mm256_cmpgt_epi32(
+						_mm256_and_si256(_mm256_set1_epi32(mask), _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128)),
+						_mm256_setzero_si256()));
+					for (int s = node.offset; s < node.offset + node.count; s++) {
+						glm::vec3 c = spheres.center(s);
+						float r = spheres.radius(s);
+						__m256 vx = _mm256_sub_ps(ox, _mm256_set1_ps(c.x));
+						__m256 vy = _mm256_sub_ps(oy, _mm256_set1_ps(c.y));
+						__m256 vz = _mm256_sub_ps(oz, _mm256_set1_ps(c.z));
+						__m256 B = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)),
+							_mm256_mul_ps(vz, dz));
+						__m256 C = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+							_mm256_mul_ps(vz, vz)), _mm256_set1_ps(r * r));
+						__m256 disc = _mm256_sub_ps(_mm256_mul_ps(B, B), _mm256_mul_ps(A, C));
+						__m256 root = _mm256_sqrt_ps(disc);
+						__m256 negB = _mm256_sub_ps(zero, B);
+						__m256 t0 = _mm256_div_ps(_mm256_sub_ps(negB, root), A);
+						__m256 t1 = _mm256_div_ps(_mm256_add_ps(negB, root), A);
+						__m256 ok0 = _mm256_and_ps(_mm256_cmp_ps(t0, inf, _CMP_LT_OQ), _mm256_cmp_ps(t0, eps, _CMP_GT_OQ));
+						__m256 ok1 = _mm256_and_ps(_mm256_cmp_ps(t1, inf, _CMP_LT_OQ), _mm256_cmp_ps(t1, eps, _CMP_GT_OQ));
+						__m256 t = _mm256_blendv_ps(t1, t0, ok0);
+						__m256 closer = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GT_OQ),
+							_mm256_or_ps(ok0, ok1)), _mm256_cmp_ps(t, tMax, _CMP_LT_OQ));
+						closer = _mm256_and_ps(closer, leafLanes);
+						tMax = _mm256_blendv_ps(tMax, t, closer);
+						hit = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(hit),
+							_mm256_castsi256_ps(_mm256_set1_epi32(s)), closer));
+					}
+					if (top == 0) break;
+					current = stack[--top];
+				}
+				else if (dirNeg[node.axis]) {
+					// 以包内第一条有效光线的方向决定先访问的子节点
+					stack[top++] = current + 1;
+					current = node.offset;
+				}
+				else {
+					stack[top++] = node.offset;
+					current = current + 1;
+				}
+			}
+			else {
+				if (top == 0) break;
+				current = stack[--top];
+			}
+		}
+
+		_mm256_store_ps(p.tMax, tMax);
+		_mm256_storeu_si256((__m256i*)p.hit, hit);
+	}
+
+	const BVH& _bvh;
+};
+
+#endif // !PACKET_H
@@ -0,0 +1,33 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+inline int hardwareThreads() {
+	unsigned int n = std::thread::hardware_concurrency();
+	return n == 0 ? 1 : int(n);
+}
+
+// 将 [0, count) 均分为 threads 段并行执行，fn(thread, begin, end)
+template <typename F>
+void parallelFor(int count, int threads, F fn) {
+	threads = std::max(1, std::min(threads, count));
+	if (threads == 1) {
+		fn(0, 0, count);
+		return;
+	}
+	int chunk = (count + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (int t = 1; t < threads; t++) {
+		int begin = std::min(count, t * chunk);
+		int end = std::min(count, begin + chunk);
+		workers.emplace_back([=, &fn]() { fn(t, begin, end); });
+	}
+	fn(0, 0, std::min(count, chunk));
+	for (std::thread& worker : workers) worker.join();
+}
+
+#endif // !PARALLEL_H
@@ -7,12 +7,22 @@
 
 static const float FLOAT_INF = 1e10f;
 static const float FLOAT_EPS = 1e-3f;
+constexpr float PI = 3.14159265358979323846f;
 
 class Ray {
 public:
+	Ray() : _origin(0.0f), _direction(0.0f, 0.0f, -1.0f) {}
 	Ray(glm::vec3 src, glm::vec3 dest):
 		_origin(src), _direction(glm::normalize(dest - src)) {}
 
+	// 直接使用给定的（已归一化的）方向，用于从 SoA 光线队列中还原光线
+	static Ray fromDirection(const glm::vec3& origin, const glm::vec3& direction) {
+		Ray ray;
+		ray._origin = origin;
+		ray._direction = direction;
+		return ray;
+	}
+
 	glm::vec3 at(float t) const { return _origin + t * _direction; }
 	glm::vec3 origin() const { return _origin; }
 	glm::vec3 direction() const { return _direction; }
@@ -0,0 +1,197 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "ray.h"
+#include "sphere.h"
+#include "material.h"
+#include "scene.h"
+#include "bvh.h"
+#include "wide_bvh.h"
+#include "tile_scheduler.h"
+#include "sampler.h"
+#include "integrator.h"
+#include "wavefront.h"
+#include "lights.h"
+#include "packet.h"
+#include "framebuffer.h"
+#include "aligned.h"
+
+// 与窗口系统无关的渲染核心：构建加速结构，按块多线程逐轮采样并累积结果。
+// 交互窗口与无界面命令行都建立在它之上
+class Renderer {
+public:
+	// sampler 为各线程采样器的原型，决定采样器的种类与种子；builder 为场景 BVH 的构建方式
+	Renderer(Scene& scene, int width, int height, int tileSize = 16, int threads = 0,
+		const Sampler& sampler = Sampler(), BVHBuildMethod builder = BVHBuildMethod::Auto) :
+		_scene(scene), _width(width), _height(height),
+		_binaryBvh(scene.buildBVH(builder, threads)), _bvh(_binaryBvh), _packets(_binaryBvh), _lights(_binaryBvh),
+		_scheduler(width, height, tileSize, threads),
+		_samplers(_scheduler.threads(), sampler),
+		_stats(_scheduler.threads()),
+		_wavefront(_scheduler.threads()),
+		_tileRadiance(_scheduler.threads()),
+		_frame(width, height, tileSize),
+		_tileConverged(_scheduler.tiles().size(), 0) {
+		for (size_t i = 0; i < _scheduler.tiles().size(); i++) _activeTiles.push_back(int(i));
+	}
+
+	int width() const { return _width; }
+	int height() const { return _height; }
+	int samples() const { return _samples; }
+	int threads() const { return _scheduler.threads(); }
+	const WideBVH& bvh() const { return _bvh; }
+	const IntegratorSettings& settings() const { return _settings; }
+	void setSettings(const IntegratorSettings& settings) { _settings = settings; }
+
+	// 到目前为止追踪的光线段总数
+	unsigned long long segments() const {
+		unsigned long long total = 0;
+		for (const ThreadStats& stats : _stats) total += stats.segments;
+		return total;
+	}
+
+	// 累积的线性辐亮度与每像素采样数，i 为列，j 为行（自下而上）
+	const Framebuffer& framebuffer() const { return _frame; }
+
+	// 尚未收敛、下一轮仍会采样的块数；关闭自适应采样时始终为全部块
+	int activeTiles() const { return int(_activeTiles.size()); }
+
+	// 开启自适应采样且所有块都已收敛，继续调用 renderSample() 不会再追加采样
+	bool converged() const { return _activeTiles.empty(); }
+
+	// 渲染一轮：每个未收敛块内的像素追加一个采样。开启自适应采样时，取满 adaptiveMinSamples 轮之后
+	// 检查刚渲染完的块，块内每个像素的估计误差都低于阈值即标记为收敛，此后的轮次跳过它
+	void renderSample() {
+		if (_activeTiles.empty()) return;
+		int sample = ++_samples;
+		const Camera& cam = _scene.camera;
+		bool adaptive = _settings.adaptiveThreshold > 0.0f && sample >= _settings.adaptiveMinSamples;
+		_scheduler.render(_activeTiles, [&](const Tile& tile, int thread) {
+			Sampler& sampler = _samplers[thread];
+			int segments = 0;
+			if (_settings.wavefront) {
+				std::vector<glm::vec3>& radiance = _tileRadiance[thread];
+				int tileWidth = tile.x1 - tile.x0;
+				radiance.resize(size_t(tileWidth) * (tile.y1 - tile.y0));
+				_wavefront[thread].render(tile, _width, _height, sample - 1, cam, _bvh, _lights, sampler, _settings,
+					radiance.data(), segments);
+				for (int j = tile.y0; j < tile.y1; j++) {
+					for (int i = tile.x0; i < tile.x1; i++) {
+						accumulate(i, j, radiance[size_t(j - tile.y0) * tileWidth + (i - tile.x0)]);
+					}
+				}
+			}
+			else if (_settings.packets && _settings.mode == ScatterMode::Single && PacketTracer::supported()) {
+				for (int j = tile.y0; j < tile.y1; j++) {
+					for (int i = tile.x0; i < tile.x1; i += RayPacket::SIZE) {
+						renderPacket(i, std::min(i + RayPacket::SIZE, tile.x1), j, sample, sampler, segments);
+					}
+				}
+			}
+			else {
+				for (int j = tile.y0; j < tile.y1; j++) {
+					for (int i = tile.x0; i < tile.x1; i++) {
+						sampler.startPixelSample(i, j, _width, uint32_t(sample - 1));
+						Ray r = cam.get_ray(i, j, _width, _height, sampler);
+						accumulate(i, j, radiance(r, _bvh, _lights, sampler, _settings, segments));
+					}
+				}
+			}
+			_stats[thread].segments += segments;
+			if (adaptive && tileConverged(tile)) _tileConverged[tileIndex(tile)] = 1;
+		});
+		if (adaptive) {
+			_activeTiles.erase(std::remove_if(_activeTiles.begin(), _activeTiles.end(),
+				[&](int tile) { return _tileConverged[tile] != 0; }), _activeTiles.end());
+		}
+	}
+
+	// 以自下而上逐行的 RGB 浮点数组导出 gamma 编码后的当前结果，供显示使用
+	void copyPixels(float* rgb) const { _frame.copyGamma(rgb); }
+
+	// 以自下而上逐行的线性 RGB 浮点数组导出当前结果，供图像输出使用
+	void copyLinear(float* rgb) const { _frame.copyLinear(rgb); }
+
+	// 每像素采样数图。normalize 为 true 时除以最大采样数，映射到 [0, 1] 供低动态范围格式使用
+	void copySampleCounts(float* rgb, bool normalize) const {
+		int most = _frame.maxSamples();
+		_frame.copySampleCounts(rgb, normalize && most > 0 ? 1.0f / float(most) : 1.0f);
+	}
+
+private:
+	Scene& _scene;
+	int _width;
+	int _height;
+	// 以一个 8x1 的光线包求像素 [x0, x1) x {j} 的主光线交点，之后各路径逐条继续追踪。
+	// 每个像素的采样器消耗顺序与逐像素路径相同
+	void renderPacket(int x0, int x1, int j, int sample, const Sampler& base, int& segments) {
+		const Camera& cam = _scene.camera;
+		Sampler samplers[RayPacket::SIZE];
+		Ray rays[RayPacket::SIZE];
+		RayPacket packet;
+		for (int i = x0; i < x1; i++) {
+			Sampler& sampler = samplers[i - x0];
+			sampler = base;
+			sampler.startPixelSample(i, j, _width, uint32_t(sample - 1));
+			rays[i - x0] = cam.get_ray(i, j, _width, _height, sampler);
+			packet.set(i - x0, rays[i - x0]);
+		}
+
+		_packets.intersect(packet);
+		for (int i = x0; i < x1; i++) {
+			int lane = i - x0;
+			segments++;
+			accumulate(i, j, continuePath(rays[lane], packet.hit[lane], packet.tMax[lane], _bvh, _lights, samplers[lane],
+				_settings, segments));
+		}
+	}
+
+	void accumulate(int i, int j, const glm::vec3& c) {
+		_frame.add(i, j, c);
+	}
+
+	int tileIndex(const Tile& tile) const {
+		int tileSize = _scheduler.tileSize();
+		int tilesX = (_width + tileSize - 1) / tileSize;
+		return (tile.y0 / tileSize) * tilesX + tile.x0 / tileSize;
+	}
+
+	bool tileConverged(const Tile& tile) const {
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				if (!(_frame.error(i, j) < _settings.adaptiveThreshold)) return false;
+			}
+		}
+		return true;
+	}
+
+	// 每线程独占一条缓存行的统计量，避免伪共享
+	struct alignas(64) ThreadStats {
+		unsigned long long segments = 0;
+	};
+
+	int _samples = 0;
+	IntegratorSettings _settings;
+	BVH _binaryBvh;
+	WideBVH _bvh;
+	PacketTracer _packets;
+	LightSet _lights;
+	TileScheduler _scheduler;
+	std::vector<Sampler> _samplers;
+	AlignedVector<ThreadStats, 64> _stats;
+	std::vector<WavefrontIntegrator> _wavefront;
+	std::vector<std::vector<glm::vec3>> _tileRadiance;
+	Framebuffer _frame;
+	std::vector<uint8_t> _tileConverged;	// 按块写入，每个块只由渲染它的线程访问
+	std::vector<int> _activeTiles;
+};
+
+#endif // !RENDERER_H
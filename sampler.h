@@ -0,0 +1,374 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// PCG32 随机数生成器（O'Neill, pcg-random.org），64 位状态，每次输出只需一次乘加与移位
+class PCG32 {
+public:
+	PCG32() { seed(0x853c49e6748fea9bull, 0xda3e39cb94b95bdbull); }
+	PCG32(uint64_t initState, uint64_t initSeq) { seed(initState, initSeq); }
+
+	void seed(uint64_t initState, uint64_t initSeq) {
+		_state = 0;
+		_inc = (initSeq << 1u) | 1u;
+		nextUInt();
+		_state += initState;
+		nextUInt();
+	}
+
+	uint32_t nextUInt() {
+		uint64_t old = _state;
+		_state = old * 6364136223846793005ull + _inc;
+		uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+		uint32_t rot = uint32_t(old >> 59u);
+		return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31));
+	}
+
+	// [0, 1) 内的均匀分布，取高 24 位保证恰好可由单精度表示
+	float nextFloat() {
+		return float(nextUInt() >> 8) * (1.0f / 16777216.0f);
+	}
+
+private:
+	uint64_t _state;
+	uint64_t _inc;
+};
+
+// 64 位整数混合（SplitMix64 的终结函数），把相邻的像素/采样编号打散为互不相关的种子
+inline uint64_t mixBits(uint64_t v) {
+	v ^= v >> 31;
+	v *= 0x7fb5d329728ea185ull;
+	v ^= v >> 27;
+	v *= 0x81dadef4bc2dd44dull;
+	v ^= v >> 33;
+	return v;
+}
+
+// 采样器的种类。除 Independent 外都按 (像素, 采样序号, 维度) 确定每个值，
+// 同一像素的各个采样在每一维（或每两维）上彼此分层，收敛快于独立采样
+enum class SamplerType {
+	Independent,	// 独立的均匀随机数
+	Stratified,		// 每一维把 [0, 1) 分成 samplesPerPixel 层（二维为 √n × √n 格），各采样按置换落入不同的层并在层内抖动
+	Sobol,			// Owen 置乱的 Sobol (0, 2) 序列，逐两维取点，每个像素、每两维独立置乱并打乱序号
+	BlueNoise		// 所有像素共用同一组置乱的 Sobol 点，按蓝噪声遮罩逐像素平移，低采样数下误差呈蓝噪声分布
+};
+
+namespace sampler_detail {
+
+inline uint32_t reverseBits(uint32_t v) {
+	v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+	v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+	v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+	v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+	return (v >> 16) | (v << 16);
+}
+
+// 基于散列的 Owen 置乱（Burley 2020，Laine–Karras 置换）：在位反转后的整数上，
+// 每一位只受更低位（即原数中更高位）影响，等价于对 [0, 1) 的嵌套均匀置乱
+inline uint32_t owenScramble(uint32_t v, uint32_t seed) {
+	v = reverseBits(v);
+	v += seed;
+	v ^= v * 0x6c50b47cu;
+	v ^= v * 0xb82f1e52u;
+	v ^= v * 0xc7afe638u;
+	v ^= v * 0x8d22f6e6u;
+	return reverseBits(v);
+}
+
+// Sobol 序列的第二维，生成矩阵为模 2 的 Pascal 矩阵；第一维即位反转（van der Corput）。
+// 生成矩阵是线性的，按字节查表后异或，置乱后的序号占满 32 位时也只需四次查表
+class SobolDimension1 {
+public:
+	static uint32_t sample(uint32_t index) {
+		static const SobolDimension1 table;
+		return table._bytes[0][index & 0xff] ^ table._bytes[1][(index >> 8) & 0xff] ^
+			table._bytes[2][(index >> 16) & 0xff] ^ table._bytes[3][index >> 24];
+	}
+
+private:
+	SobolDimension1() {
+		uint32_t directions[32];
+		directions[0] = 0x80000000u;
+		for (int bit = 1; bit < 32; bit++) directions[bit] = directions[bit - 1] ^ (directions[bit - 1] >> 1);
+		for (int byte = 0; byte < 4; byte++) {
+			for (uint32_t value = 0; value < 256; value++) {
+				uint32_t result = 0;
+				for (int bit = 0; bit < 8; bit++) {
+					if (value & (1u << bit)) result ^= directions[byte * 8 + bit];
+				}
+				_bytes[byte][value] = result;
+			}
+		}
+	}
+
+	uint32_t _bytes[4][256];
+};
+
+// 把 [0, length) 内的 i 映射为由 seed 决定的一个置换中的元素，不需要存储置换表（Kensler 2013）
+inline uint32_t permutationElement(uint32_t i, uint32_t length, uint32_t seed) {
+	uint32_t w = length - 1;
+	w |= w >> 1;
+	w |= w >> 2;
+	w |= w >> 4;
+	w |= w >> 8;
+	w |= w >> 16;
+	do {
+		i ^= seed;
+		i *= 0xe170893du;
+		i ^= seed >> 16;
+		i ^= (i & w) >> 4;
+		i ^= seed >> 8;
+		i *= 0x0929eb3fu;
+		i ^= seed >> 23;
+		i ^= (i & w) >> 1;
+		i *= 1 | seed >> 27;
+		i *= 0x6935fa69u;
+		i ^= (i & w) >> 11;
+		i *= 0x74dcb303u;
+		i ^= (i & w) >> 2;
+		i *= 0x9e501cc3u;
+		i ^= (i & w) >> 2;
+		i *= 0xc860a3dfu;
+		i &= w;
+		i ^= i >> 5;
+	} while (i >= length);
+	return (i + seed) % length;
+}
+
+// 把舍入后可能等于 1 的值压回小于 1 的最大 float
+inline float belowOne(float v) {
+	return v < 0.99999994f ? v : 0.99999994f;
+}
+
+// 32 位定点数转为 [0, 1) 内的 float，取高 24 位
+inline float toUnitFloat(uint32_t v) {
+	return float(v >> 8) * (1.0f / 16777216.0f);
+}
+
+// 64 x 64 的平铺蓝噪声遮罩，以 void-and-cluster 算法（Ulichney 1993）生成，
+// 每个像素的值为其排名 (rank + 0.5) / 4096，任意阈值下选中的像素都尽量均匀地分散
+class BlueNoiseMask {
+public:
+	static constexpr int SIZE = 64;
+	static constexpr int COUNT = SIZE * SIZE;
+
+	// 首次使用时生成（约 0.1 秒），之后全局共享
+	static const BlueNoiseMask& instance() {
+		static const BlueNoiseMask mask;
+		return mask;
+	}
+
+	float operator()(int x, int y) const { return _value[(y & (SIZE - 1)) * SIZE + (x & (SIZE - 1))]; }
+
+private:
+	BlueNoiseMask() : _value(COUNT), _kernel(COUNT), _energy(COUNT), _bits(COUNT) {
+		// 平铺（环形）距离下的高斯核，σ = 1.5
+		for (int y = 0; y < SIZE; y++) {
+			for (int x = 0; x < SIZE; x++) {
+				float dx = float(std::min(x, SIZE - x)), dy = float(std::min(y, SIZE - y));
+				_kernel[y * SIZE + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.5f * 1.5f));
+			}
+		}
+
+		// 随机放置十分之一的点，再反复把最密的点移到最大的空隙，直到不再移动
+		PCG32 rng;
+		int ones = 0;
+		while (ones < COUNT / 10) {
+			int p = int(rng.nextUInt() % COUNT);
+			if (_bits[p]) continue;
+			toggle(p);
+			ones++;
+		}
+		for (int iteration = 0; iteration < COUNT; iteration++) {
+			int cluster = tightestCluster();
+			toggle(cluster);
+			int gap = largestVoid();
+			toggle(gap);
+			if (gap == cluster) break;
+		}
+		std::vector<uint8_t> initialBits = _bits;
+		std::vector<float> initialEnergy = _energy;
+
+		// 从初始图案中依次移除最密的点，排名由高到低
+		std::vector<int> rank(COUNT);
+		for (int r = ones - 1; r >= 0; r--) {
+			int p = tightestCluster();
+			toggle(p);
+			rank[p] = r;
+		}
+		// 再从初始图案起依次填入最大的空隙直到填满。填满一半之后按"少数像素"为空位的做法，
+		// 最密的空位即能量最低的空位，与前一半相同
+		_bits = initialBits;
+		_energy = initialEnergy;
+		for (int r = ones; r < COUNT; r++) {
+			int p = largestVoid();
+			toggle(p);
+			rank[p] = r;
+		}
+		for (int p = 0; p < COUNT; p++) _value[p] = (float(rank[p]) + 0.5f) / float(COUNT);
+		std::vector<float>().swap(_kernel);
+		std::vector<float>().swap(_energy);
+	}
+
+	// 加入或移除点 p，并更新每个位置受所有点影响的能量
+	void toggle(int p) {
+		_bits[p] ^= 1;
+		float sign = _bits[p] ? 1.0f : -1.0f;
+		int px = p % SIZE, py = p / SIZE;
+		for (int y = 0; y < SIZE; y++) {
+			const float* row = &_kernel[((y - py) & (SIZE - 1)) * SIZE];
+			float* energy = &_energy[y * SIZE];
+			for (int x = 0; x < SIZE; x++) energy[x] += sign * row[(x - px) & (SIZE - 1)];
+		}
+	}
+
+	int tightestCluster() const {
+		int best = -1;
+		for (int p = 0; p < COUNT; p++) {
+			if (_bits[p] && (best < 0 || _energy[p] > _energy[best])) best = p;
+		}
+		return best;
+	}
+
+	int largestVoid() const {
+		int best = -1;
+		for (int p = 0; p < COUNT; p++) {
+			if (!_bits[p] && (best < 0 || _energy[p] < _energy[best])) best = p;
+		}
+		return best;
+	}
+
+	std::vector<float> _value;
+	std::vector<float> _kernel;
+	std::vector<float> _energy;
+	std::vector<uint8_t> _bits;
+};
+
+} // namespace sampler_detail
+
+// 渲染用的采样器：每个线程持有一个，按 (像素, 采样序号, 全局种子) 确定性地重新播种，
+// 因此同一种子下的渲染结果与线程数和块的调度顺序无关。
+// 每次 get1D() / get2D() 消耗一维或两维，维度从 startPixelSample() 给出的值开始依次递增；
+// 相机光线的像素内抖动总是第 0、1 维。各种类的实现用 switch 分派，采样器保持可按值复制，
+// 波前积分器可以把它随路径一起存放
+class Sampler {
+public:
+	explicit Sampler(uint64_t seed = 0, SamplerType type = SamplerType::Independent, int samplesPerPixel = 1) :
+		_seedHash(mixBits(seed)), _type(type), _samplesPerPixel(uint32_t(std::max(samplesPerPixel, 1))) {
+		if (type == SamplerType::BlueNoise) sampler_detail::BlueNoiseMask::instance();
+	}
+
+	SamplerType type() const { return _type; }
+
+	// 开始像素 (x, y) 的第 sample 个采样（从 0 开始），width 为图像宽度，之后从第 dimension 维取值
+	void startPixelSample(int x, int y, int width, uint32_t sample, int dimension = 0) {
+		uint32_t pixel = uint32_t(y * width + x);
+		uint64_t key = (uint64_t(pixel) << 32) | sample;
+		_rng.seed(mixBits(key ^ _seedHash), pixel);
+		_x = x;
+		_y = y;
+		_pixel = pixel;
+		_sample = sample;
+		_dimension = uint32_t(dimension);
+	}
+
+	// 下一次取值使用的维度
+	int dimension() const { return int(_dimension); }
+
+	float get1D() {
+		using namespace sampler_detail;
+		uint32_t dimension = _dimension++;
+		switch (_type) {
+		case SamplerType::Stratified: {
+			uint32_t stratum = permutationElement(_sample % _samplesPerPixel, _samplesPerPixel,
+				uint32_t(hash(dimension, true)));
+			return belowOne((float(stratum) + _rng.nextFloat()) / float(_samplesPerPixel));
+		}
+		case SamplerType::Sobol:
+		case SamplerType::BlueNoise: {
+			bool perPixel = _type == SamplerType::Sobol;
+			uint64_t h = hash(dimension, perPixel);
+			uint32_t index = owenScramble(_sample, uint32_t(h));
+			float u = toUnitFloat(owenScramble(reverseBits(index), uint32_t(h >> 32)));
+			return perPixel ? u : shift(u, dimension);
+		}
+		default:
+			return _rng.nextFloat();
+		}
+	}
+
+	glm::vec2 get2D() {
+		using namespace sampler_detail;
+		uint32_t dimension = _dimension;
+		_dimension += 2;
+		switch (_type) {
+		case SamplerType::Stratified: {
+			uint32_t side = std::max(uint32_t(std::sqrt(float(_samplesPerPixel))), 1u);
+			uint32_t cells = side * side;
+			uint32_t cell = permutationElement(_sample % cells, cells, uint32_t(hash(dimension, true)));
+			float x = (float(cell % side) + _rng.nextFloat()) / float(side);
+			float y = (float(cell / side) + _rng.nextFloat()) / float(side);
+			return glm::vec2(belowOne(x), belowOne(y));
+		}
+		case SamplerType::Sobol:
+		case SamplerType::BlueNoise: {
+			bool perPixel = _type == SamplerType::Sobol;
+			uint64_t h = hash(dimension, perPixel);
+			uint64_t h2 = (h ^ (h >> 29)) * 0xbf58476d1ce4e5b9ull;
+			uint32_t index = owenScramble(_sample, uint32_t(h));
+			float x = toUnitFloat(owenScramble(reverseBits(index), uint32_t(h >> 32)));
+			float y = toUnitFloat(owenScramble(SobolDimension1::sample(index), uint32_t(h2 >> 32)));
+			if (perPixel) return glm::vec2(x, y);
+			return glm::vec2(shift(x, dimension), shift(y, dimension + 1));
+		}
+		default: {
+			float x = _rng.nextFloat();
+			float y = _rng.nextFloat();
+			return glm::vec2(x, y);
+		}
+		}
+	}
+
+	glm::vec3 get3D() {
+		if (_type == SamplerType::Independent) {
+			float x = _rng.nextFloat();
+			float y = _rng.nextFloat();
+			float z = _rng.nextFloat();
+			return glm::vec3(x, y, z);
+		}
+		glm::vec2 xy = get2D();
+		return glm::vec3(xy, get1D());
+	}
+
+private:
+	// 某一维的散列种子。perPixel 为 false 时所有像素相同（蓝噪声采样器共用同一组点）
+	uint64_t hash(uint32_t dimension, bool perPixel) const {
+		uint64_t key = (uint64_t(perPixel ? _pixel + 1 : 0) << 32) | dimension;
+		return mixBits(key ^ _seedHash);
+	}
+
+	// 按蓝噪声遮罩平移（Cranley–Patterson 旋转），每一维从遮罩的不同位置读取，相邻维度互不相关
+	float shift(float u, uint32_t dimension) const {
+		uint64_t offset = mixBits(uint64_t(dimension) ^ 0x9e3779b97f4a7c15ull);
+		float v = u + sampler_detail::BlueNoiseMask::instance()(_x + int(offset & 63), _y + int((offset >> 6) & 63));
+		return sampler_detail::belowOne(v >= 1.0f ? v - 1.0f : v);
+	}
+
+	uint64_t _seedHash;
+	SamplerType _type;
+	uint32_t _samplesPerPixel;
+	PCG32 _rng;
+	int _x = 0;
+	int _y = 0;
+	uint32_t _pixel = 0;
+	uint32_t _sample = 0;
+	uint32_t _dimension = 0;
+};
+
+#endif // !SAMPLER_H
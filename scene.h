@@ -0,0 +1,127 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <random>
+#include <memory>
+#include <cmath>
+#include <utility>
+
+#include "camera.h"
+#include "material.h"
+#include "sphere.h"
+#include "bvh.h"
+#include "lbvh.h"
+#include "scene_cache.h"
+#include "arena.h"
+
+// 场景：相机、材质表与球体。材质与球体都分配在场景独占的内存池中，按创建顺序连续存放，
+// 随场景一次性释放；材质按下标引用并可被多个球体共享。从场景缓存加载的场景不含 Sphere 对象，几何与 BVH 都留在映射的文件中
+class Scene {
+public:
+	Scene(const View& view, float aspect) : view(view), camera(view.camera(aspect)) {}
+
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	void setAspect(float aspect) { camera = view.camera(aspect); }
+
+	// 在内存池中创建类型为 M 的材质，返回其下标
+	template <typename M, typename... Args>
+	int addMaterial(Args&&... args) {
+		_materials.push_back(_arena.create<M>(std::forward<Args>(args)...));
+		return int(_materials.size()) - 1;
+	}
+
+	void addSphere(const glm::vec3& center, float radius, int material) {
+		_world.push_back(_arena.create<Sphere>(center, radius, _materials[material]));
+	}
+
+	// 预留 count 个球体的空间，使它们落在同一块连续内存中
+	void reserveSpheres(int count) {
+		_world.reserve(_world.size() + count);
+		_arena.reserve(size_t(count) * sizeof(Sphere));
+	}
+
+	int materialCount() const { return int(_materials.size()); }
+	Material* material(int i) const { return _materials[i]; }
+
+	// 供 BVH 构建使用的球体指针数组，按添加顺序排列
+	Sphere** world() { return _world.data(); }
+	int size() const { return _cache ? _cache->sphereCount() : int(_world.size()); }
+
+	// 场景缓存的材质表须与本场景的材质按相同顺序一一对应
+	void setCache(std::unique_ptr<SceneCache> cache) { _cache = std::move(cache); }
+	const SceneCache* cache() const { return _cache.get(); }
+
+	// Auto 构建方式改用 LBVH 的球体数，此规模下 SAH 构建已需数百毫秒
+	static constexpr int LBVH_THRESHOLD = 100000;
+
+	// 场景的二叉 BVH：有缓存时直接引用缓存中的数据，否则按 method 构建，threads 为 LBVH 的构建线程数（0 为全部）
+	BVH buildBVH(BVHBuildMethod method = BVHBuildMethod::Auto, int threads = 0) {
+		if (_cache) return _cache->bvh(_materials);
+		int length = int(_world.size());
+		if (method == BVHBuildMethod::Auto) {
+			method = length >= LBVH_THRESHOLD ? BVHBuildMethod::LBVH : BVHBuildMethod::SAH;
+		}
+		if (method == BVHBuildMethod::SAH) return BVH(world(), length);
+		LBVHBuilder builder(threads);
+		return BVH(world(), builder.build(world(), length));
+	}
+
+	View view;
+	Camera camera;
+	SceneSettings settings;	// 场景文件中的渲染设置
+
+private:
+	Arena _arena;
+	std::vector<Material*> _materials;
+	std::vector<Sphere*> _world;
+	std::unique_ptr<SceneCache> _cache;
+};
+
+// 随机场景：大地面、约 480 个随机材质的小球和三个大球，同一种子生成的场景相同
+inline std::unique_ptr<Scene> randomScene(float aspect, unsigned int seed = 2020) {
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> distribution(0.0, 1.0);
+
+	std::unique_ptr<Scene> scene(new Scene(View(), aspect));
+
+	scene->addSphere(glm::vec3(0.0f, -1000.0f, 0.0f), 1000.0f,
+		scene->addMaterial<Lambertian>(glm::vec3(0.5f, 0.5f, 0.5f)));
+	for (int a = -11; a < 11; a++) {
+		for (int b = -11; b < 11; b++) {
+			float choose_mat = distribution(gen);
+			glm::vec3 center(a + 0.9f * distribution(gen), 0.2f, b + 0.9f * distribution(gen));
+			auto tmp = center - glm::vec3(4.0f, 0.2f, 0.0f);
+			if (std::sqrt(glm::dot(tmp, tmp)) > 0.9f) {
+				if (choose_mat < 0.8f) { // diffuse
+					scene->addSphere(center, 0.2f, scene->addMaterial<Lambertian>(
+						glm::vec3(distribution(gen) * distribution(gen), distribution(gen) * distribution(gen),
+							distribution(gen) * distribution(gen))));
+				}
+				else if (choose_mat < 0.95f) { // metal
+					scene->addSphere(center, 0.2f, scene->addMaterial<Metal>(
+						glm::vec3(0.5f * (1.0f + distribution(gen)), 0.5f * (1.0f + distribution(gen)),
+							0.5f * (1.0f + distribution(gen)))));
+				}
+				else // glass
+				{
+					scene->addSphere(center, 0.2f, scene->addMaterial<Dielectric>(1.5f));
+				}
+			}
+		}
+	}
+
+	scene->addSphere(glm::vec3(6.0f, 1.0f, 0.0f), 1.0f,
+		scene->addMaterial<Metal>(glm::vec3(0.7f, 0.6f, 0.5f)));
+	scene->addSphere(glm::vec3(2.0f, 1.0f, 0.0f), 1.0f,
+		scene->addMaterial<Dielectric>(1.5f));
+	scene->addSphere(glm::vec3(-2.0f, 1.0f, 0.0f), 1.0f,
+		scene->addMaterial<Lambertian>(glm::vec3(0.4f, 0.2f, 0.1f)));
+	return scene;
+}
+
+#endif // !SCENE_H
@@ -0,0 +1,291 @@
+#ifndef SCENE_CACHE_H
+#define SCENE_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+
+#include "camera.h"
+#include "material.h"
+#include "bvh.h"
+#include "sphere_soa.h"
+#include "mapped_file.h"
+
+// 场景中的渲染设置（"set key value"），按出现顺序保存
+typedef std::vector<std::pair<std::string, std::string>> SceneSettings;
+
+// 二进制场景缓存：把场景文件解析并构建好 BVH 之后的结果原样存入一个文件，之后的渲染任务
+// 只需内存映射即可直接使用其中的数组，不做任何解析与构建。文件布局（小端，各段按 64 字节对齐）：
+//
+//   SceneCacheHeader
+//   材质表       materialCount 个 SceneCacheMaterial
+//   球体         x、y、z、半径、材质编号五个数组，各 sphereCount + SphereSoA::PADDING 个元素，间隔 sphereStride 字节
+//   BVH 节点     nodeCount 个 LinearBVHNode，深度优先排列
+//   渲染设置     settingsSize 字节的文本，每行 "key value"
+//
+// 球体按 BVH 叶子顺序排列，材质编号是材质表的下标。格式变化时递增 SceneCache::VERSION
+
+struct SceneCacheHeader {
+	char magic[8];			// "RTSCACHE"
+	uint32_t version;
+	uint32_t byteOrder;		// 写入 0x01020304，用于识别字节序不同的机器写出的文件
+	uint32_t sphereCount;
+	uint32_t materialCount;
+	uint32_t nodeCount;
+	uint32_t settingsSize;
+	float view[10];			// lookfrom、lookat、up、vfov
+	uint64_t materialOffset;
+	uint64_t sphereOffset;
+	uint64_t sphereStride;
+	uint64_t nodeOffset;
+	uint64_t settingsOffset;
+	uint64_t fileSize;
+};
+static_assert(sizeof(SceneCacheHeader) == 120, "SceneCacheHeader layout changed");
+
+// 材质表的一项：颜色类材质的 params 为 RGB（发光材质为辐亮度），电介质的 params[0] 为折射率
+struct SceneCacheMaterial {
+	uint32_t kind;			// MaterialKind
+	float params[3];
+};
+static_assert(sizeof(SceneCacheMaterial) == 16, "SceneCacheMaterial must be 16 bytes");
+
+class SceneCache {
+public:
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+	static constexpr size_t ALIGNMENT = 64;
+
+	// 只读取文件开头的标识，判断 path 是否是场景缓存
+	static bool probe(const std::string& path) {
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		if (file == nullptr) return false;
+		char magic[8];
+		bool match = std::fread(magic, 1, 8, file) == 8 && std::memcmp(magic, "RTSCACHE", 8) == 0;
+		std::fclose(file);
+		return match;
+	}
+
+	// 映射并校验文件头与各段的范围，不访问各段的内容
+	bool open(const std::string& path, std::string& error) {
+		if (!_file.open(path, error)) return false;
+		_header = nullptr;
+		const SceneCacheHeader* header = reinterpret_cast<const SceneCacheHeader*>(_file.data());
+		if (_file.size() < sizeof(SceneCacheHeader) || std::memcmp(header->magic, "RTSCACHE", 8) != 0) {
+			error = path + ": not a scene cache";
+			return false;
+		}
+		if (header->byteOrder != BYTE_ORDER_MARK || header->version != VERSION) {
+			error = path + ": scene cache version " + std::to_string(header->version) +
+				" is not supported (expected " + std::to_string(VERSION) + "), rebuild it with --write-cache";
+			return false;
+		}
+		uint64_t padded = uint64_t(header->sphereCount) + SphereSoA::PADDING;
+		bool ok = header->fileSize == _file.size() &&
+			inRange(header->materialOffset, uint64_t(header->materialCount) * sizeof(SceneCacheMaterial)) &&
+			header->sphereStride >= padded * sizeof(float) &&
+			inRange(header->sphereOffset, header->sphereStride * 5) &&
+			inRange(header->nodeOffset, uint64_t(header->nodeCount) * sizeof(LinearBVHNode)) &&
+			inRange(header->settingsOffset, header->settingsSize) &&
+			header->materialOffset % ALIGNMENT == 0 && header->sphereOffset % ALIGNMENT == 0 &&
+			header->sphereStride % ALIGNMENT == 0 && header->nodeOffset % ALIGNMENT == 0;
+		if (!ok || !validContents(*header)) {
+			error = path + ": scene cache is truncated or corrupt";
+			return false;
+		}
+		_header = header;
+		return true;
+	}
+
+	int sphereCount() const { return int(_header->sphereCount); }
+	int materialCount() const { return int(_header->materialCount); }
+	int nodeCount() const { return int(_header->nodeCount); }
+
+	View view() const {
+		const float* v = _header->view;
+		View view;
+		view.lookfrom = glm::vec3(v[0], v[1], v[2]);
+		view.lookat = glm::vec3(v[3], v[4], v[5]);
+		view.up = glm::vec3(v[6], v[7], v[8]);
+		view.vfov = v[9];
+		return view;
+	}
+
+	const SceneCacheMaterial& material(int i) const {
+		return at<SceneCacheMaterial>(_header->materialOffset)[i];
+	}
+
+	SceneSettings settings() const {
+		SceneSettings settings;
+		const char* text = at<char>(_header->settingsOffset);
+		std::string blob(text, text + _header->settingsSize);
+		size_t start = 0;
+		while (start < blob.size()) {
+			size_t end = blob.find('\n', start);
+			if (end == std::string::npos) end = blob.size();
+			size_t space = blob.find(' ', start);
+			if (space < end) settings.emplace_back(blob.substr(start, space - start), blob.substr(space + 1, end - space - 1));
+			start = end + 1;
+		}
+		return settings;
+	}
+
+	// 直接引用映射内存的 BVH，materials 按材质表的顺序给出。返回的 BVH 不得比本对象存活得更久
+	BVH bvh(std::vector<Material*> materials) const {
+		const SceneCacheHeader& h = *_header;
+		uint64_t s = h.sphereOffset;
+		SphereSoA spheres = SphereSoA::view(at<float>(s), at<float>(s + h.sphereStride),
+			at<float>(s + 2 * h.sphereStride), at<float>(s + 3 * h.sphereStride),
+			at<int>(s + 4 * h.sphereStride), int(h.sphereCount));
+		return BVH(at<LinearBVHNode>(h.nodeOffset), int(h.nodeCount), std::move(spheres), std::move(materials));
+	}
+
+private:
+	// 遍历时的固定大小栈以树深为上限
+	static constexpr int MAX_DEPTH = BVH::MAX_DEPTH;
+
+	// 逐项检查会被当作下标使用的数据：球体的材质编号在材质表内，叶子的球体区间在球体数内，
+	// 右子节点在节点数内且位于父节点之后（深度优先排列，不会成环），树深不超过 MAX_DEPTH。
+	// 只做一次线性扫描，损坏的缓存在这里报错而不是在渲染中越界访问
+	bool validContents(const SceneCacheHeader& h) const {
+		const int* material = at<int>(h.sphereOffset + 4 * h.sphereStride);
+		for (uint32_t i = 0; i < h.sphereCount; i++) {
+			if (material[i] < 0 || uint32_t(material[i]) >= h.materialCount) return false;
+		}
+
+		const LinearBVHNode* nodes = at<LinearBVHNode>(h.nodeOffset);
+		std::vector<unsigned char> depth(h.nodeCount, 0);
+		for (uint32_t i = 0; i < h.nodeCount; i++) {
+			const LinearBVHNode& node = nodes[i];
+			if (node.count > 0) {
+				if (node.offset < 0 || uint64_t(node.offset) + node.count > h.sphereCount) return false;
+				continue;
+			}
+			uint32_t left = i + 1;
+			if (node.offset <= int64_t(left) || uint32_t(node.offset) >= h.nodeCount) return false;
+			if (depth[i] + 1 >= MAX_DEPTH) return false;
+			// 父节点的下标总小于子节点，处理到某个节点时它的所有父节点都已处理过
+			for (uint32_t child : { left, uint32_t(node.offset) }) {
+				depth[child] = std::max(depth[child], (unsigned char)(depth[i] + 1));
+			}
+		}
+		return true;
+	}
+
+	bool inRange(uint64_t offset, uint64_t size) const {
+		return offset <= _file.size() && size <= _file.size() - offset;
+	}
+
+	template <typename T>
+	const T* at(uint64_t offset) const {
+		return reinterpret_cast<const T*>(_file.data() + offset);
+	}
+
+	MappedFile _file;
+	const SceneCacheHeader* _header = nullptr;
+};
+
+namespace scene_cache_detail {
+
+inline uint64_t alignUp(uint64_t offset) {
+	return (offset + SceneCache::ALIGNMENT - 1) / SceneCache::ALIGNMENT * SceneCache::ALIGNMENT;
+}
+
+inline SceneCacheMaterial encodeMaterial(const Material* material) {
+	SceneCacheMaterial record = {};
+	record.kind = uint32_t(material->kind());
+	glm::vec3 color(0.0f);
+	switch (material->kind()) {
+	case MaterialKind::Lambertian: color = static_cast<const Lambertian*>(material)->color(); break;
+	case MaterialKind::Metal: color = static_cast<const Metal*>(material)->color(); break;
+	case MaterialKind::Dielectric: color.x = static_cast<const Dielectric*>(material)->reflectIdx(); break;
+	case MaterialKind::Emissive: color = static_cast<const Emissive*>(material)->radiance(); break;
+	default: break;
+	}
+	record.params[0] = color.x;
+	record.params[1] = color.y;
+	record.params[2] = color.z;
+	return record;
+}
+
+} // namespace scene_cache_detail
+
+// 把构建好的 BVH 连同相机与渲染设置写成场景缓存
+inline bool writeSceneCache(const std::string& path, const View& view, const BVH& bvh,
+	const SceneSettings& settings, std::string& error) {
+	using namespace scene_cache_detail;
+	// 与 SceneCache::open 的检查一致，不写出加载时会被拒绝的树
+	if (bvh.depth() >= BVH::MAX_DEPTH) {
+		error = "BVH of depth " + std::to_string(bvh.depth()) + " is too deep for a scene cache";
+		return false;
+	}
+	std::string blob;
+	for (const auto& setting : settings) blob += setting.first + " " + setting.second + "\n";
+
+	const SphereSoA& spheres = bvh.spheres();
+	uint64_t padded = uint64_t(spheres.size()) + SphereSoA::PADDING;
+	SceneCacheHeader header = {};
+	std::memcpy(header.magic, "RTSCACHE", 8);
+	header.version = SceneCache::VERSION;
+	header.byteOrder = SceneCache::BYTE_ORDER_MARK;
+	header.sphereCount = uint32_t(spheres.size());
+	header.materialCount = uint32_t(bvh.materials().size());
+	header.nodeCount = uint32_t(bvh.nodeCount());
+	header.settingsSize = uint32_t(blob.size());
+	const float v[10] = { view.lookfrom.x, view.lookfrom.y, view.lookfrom.z, view.lookat.x, view.lookat.y,
+		view.lookat.z, view.up.x, view.up.y, view.up.z, view.vfov };
+	std::memcpy(header.view, v, sizeof(v));
+	header.materialOffset = alignUp(sizeof(SceneCacheHeader));
+	header.sphereOffset = alignUp(header.materialOffset + header.materialCount * sizeof(SceneCacheMaterial));
+	header.sphereStride = alignUp(padded * sizeof(float));
+	header.nodeOffset = alignUp(header.sphereOffset + 5 * header.sphereStride);
+	header.settingsOffset = header.nodeOffset + uint64_t(header.nodeCount) * sizeof(LinearBVHNode);
+	header.fileSize = header.settingsOffset + header.settingsSize;
+
+	std::ofstream os(path, std::ios::binary);
+	if (!os) {
+		error = "failed to create scene cache " + path;
+		return false;
+	}
+	uint64_t written = 0;
+	auto put = [&](const void* data, uint64_t size) {
+		os.write(static_cast<const char*>(data), std::streamsize(size));
+		written += size;
+	};
+	auto padTo = [&](uint64_t offset) {
+		static const char zeros[SceneCache::ALIGNMENT] = {};
+		put(zeros, offset - written);
+	};
+
+	put(&header, sizeof(header));
+	padTo(header.materialOffset);
+	for (Material* material : bvh.materials()) {
+		SceneCacheMaterial record = encodeMaterial(material);
+		put(&record, sizeof(record));
+	}
+	const void* arrays[5] = { spheres.xData(), spheres.yData(), spheres.zData(), spheres.radiusData(),
+		spheres.materialData() };
+	for (int k = 0; k < 5; k++) {
+		padTo(header.sphereOffset + k * header.sphereStride);
+		put(arrays[k], padded * sizeof(float));
+	}
+	padTo(header.nodeOffset);
+	put(bvh.nodes(), uint64_t(header.nodeCount) * sizeof(LinearBVHNode));
+	put(blob.data(), blob.size());
+	if (!os) {
+		error = "failed to write scene cache " + path;
+		return false;
+	}
+	return true;
+}
+
+#endif // !SCENE_CACHE_H
@@ -0,0 +1,321 @@
+#ifndef SCENE_LOADER_H
+#define SCENE_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <algorithm>
+
+#include "scene.h"
+#include "material.h"
+#include "config.h"
+
+// 场景文件格式：逐行的文本，# 之后为注释，字段之间以空白分隔。
+//
+//   camera <from x y z> <at x y z> <up x y z> <vfov>
+//   material <name> lambertian <r g b>
+//   material <name> metal <r g b>
+//   material <name> dielectric <ior>
+//   material <name> emissive <r g b>  发光材质，r g b 为辐亮度，可以大于 1
+//   sphere <x y z> <radius> <material name>
+//   set <key> <value>            渲染设置，键与配置文件相同（如 samples、max-depth）
+//
+// 材质必须先于引用它的球体定义，同名材质由所有引用它的球体共享。
+// 渲染设置的优先级低于配置文件与命令行。
+//
+// --scene 也可以指定由 --write-cache 生成的二进制场景缓存（见 scene_cache.h），按文件头识别
+
+namespace scene_detail {
+
+// 十进制浮点数的快速解析：整数部分与小数部分累积为 64 位整数，再乘以 10 的幂。
+// 超过 18 位有效数字或形如 inf、nan、十六进制的写法交给 strtod
+inline bool parseFloat(const char*& p, float& value) {
+	while (*p == ' ' || *p == '\t') p++;
+	const char* start = p;
+	bool negative = false;
+	if (*p == '-' || *p == '+') negative = *p++ == '-';
+
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	bool any = false;
+	for (; *p >= '0' && *p <= '9'; p++, any = true) {
+		if (digits < 18) {
+			mantissa = mantissa * 10 + unsigned(*p - '0');
+			if (mantissa != 0) digits++;
+		}
+		else exponent++;
+	}
+	if (*p == '.') {
+		for (p++; *p >= '0' && *p <= '9'; p++, any = true) {
+			if (digits < 18) {
+				mantissa = mantissa * 10 + unsigned(*p - '0');
+				if (mantissa != 0) digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!any || digits >= 18) {
+		char* end = nullptr;
+		double v = std::strtod(start, &end);
+		if (end == start) return false;
+		p = end;
+		value = float(v);
+		return true;
+	}
+	if (*p == 'e' || *p == 'E') {
+		const char* e = p + 1;
+		bool negExp = false;
+		if (*e == '-' || *e == '+') negExp = *e++ == '-';
+		if (*e >= '0' && *e <= '9') {
+			int x = 0;
+			for (; *e >= '0' && *e <= '9'; e++) x = std::min(x * 10 + (*e - '0'), 10000);
+			exponent += negExp ? -x : x;
+			p = e;
+		}
+	}
+
+	static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	double v = double(mantissa);
+	if (exponent < -22 || exponent > 22) {
+		char* end = nullptr;
+		v = std::strtod(start, &end);
+		p = end;
+	}
+	else if (exponent < 0) v /= POW10[-exponent];
+	else v *= POW10[exponent];
+	value = float(negative ? -v : v);
+	return true;
+}
+
+inline bool parseVec3(const char*& p, glm::vec3& v) {
+	return parseFloat(p, v.x) && parseFloat(p, v.y) && parseFloat(p, v.z);
+}
+
+// 取下一个以空白分隔的词，返回其长度
+inline size_t nextWord(const char*& p, const char*& word) {
+	while (*p == ' ' || *p == '\t') p++;
+	word = p;
+	while (*p != '\0' && *p != ' ' && *p != '\t') p++;
+	return size_t(p - word);
+}
+
+inline bool atEnd(const char* p) {
+	while (*p == ' ' || *p == '\t') p++;
+	return *p == '\0';
+}
+
+} // namespace scene_detail
+
+// 流式读取场景文件：按块读入并逐行解析，球体直接写入场景的连续存储。
+// 渲染设置写入 Scene::settings；出错时返回 nullptr 并在 error 中给出行号
+inline std::unique_ptr<Scene> loadSceneFile(const std::string& path, float aspect, std::string& error) {
+	using namespace scene_detail;
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr) {
+		error = "failed to open scene file " + path;
+		return nullptr;
+	}
+
+	std::unique_ptr<Scene> scene(new Scene(View(), aspect));
+	std::unordered_map<std::string, int> materials;
+	std::string lastName;
+	int lastMaterial = -1;
+
+	// 按文件大小粗略预留球体存储，一行球体描述约 40 字节
+	std::fseek(file, 0, SEEK_END);
+	long fileSize = std::ftell(file);
+	std::fseek(file, 0, SEEK_SET);
+	if (fileSize > 0) scene->reserveSpheres(int(fileSize / 40));
+
+	const size_t CHUNK = 1 << 20;
+	std::vector<char> buffer(CHUNK + 1);
+	size_t carry = 0;
+	int number = 0;
+	bool failed = false;
+	auto fail = [&](const std::string& message) {
+		error = path + ":" + std::to_string(number) + ": " + message;
+		failed = true;
+	};
+
+	// 处理一行（已去掉换行并以 '\0' 结尾）
+	auto parseLine = [&](char* line) {
+		number++;
+		char* comment = std::strchr(line, '#');
+		if (comment != nullptr) *comment = '\0';
+		size_t length = std::strlen(line);
+		if (length > 0 && line[length - 1] == '\r') line[length - 1] = '\0';
+
+		const char* p = line;
+		const char* word;
+		size_t n = nextWord(p, word);
+		if (n == 0) return;
+
+		if (n == 6 && std::memcmp(word, "sphere", 6) == 0) {
+			glm::vec3 center;
+			float radius;
+			if (!parseVec3(p, center) || !parseFloat(p, radius)) return fail("expected 'sphere x y z radius material'");
+			// 非有限的坐标会让 BVH 构建中的分桶与 Morton 码失去意义
+			if (!std::isfinite(center.x) || !std::isfinite(center.y) || !std::isfinite(center.z)) {
+				return fail("sphere center must be finite");
+			}
+			if (!std::isfinite(radius) || !(radius > 0.0f)) return fail("sphere radius must be positive and finite");
+			const char* name;
+			size_t nameLength = nextWord(p, name);
+			if (nameLength == 0 || !atEnd(p)) return fail("expected a material name after the sphere radius");
+			// 相邻的球体通常使用同一种材质，先与上一次的名字比较以避免哈希
+			if (lastMaterial < 0 || lastName.size() != nameLength || lastName.compare(0, nameLength, name, nameLength) != 0) {
+				lastName.assign(name, nameLength);
+				auto found = materials.find(lastName);
+				if (found == materials.end()) {
+					lastMaterial = -1;
+					return fail("undefined material '" + lastName + "'");
+				}
+				lastMaterial = found->second;
+			}
+			scene->addSphere(center, radius, lastMaterial);
+		}
+		else if (n == 8 && std::memcmp(word, "material", 8) == 0) {
+			const char* name;
+			size_t nameLength = nextWord(p, name);
+			const char* type;
+			size_t typeLength = nextWord(p, type);
+			if (nameLength == 0 || typeLength == 0) return fail("expected 'material name type parameters'");
+			std::string typeName(type, typeLength);
+			glm::vec3 color;
+			float ior;
+			MaterialKind kind;
+			if (typeName == "lambertian" && parseVec3(p, color)) kind = MaterialKind::Lambertian;
+			else if (typeName == "metal" && parseVec3(p, color)) kind = MaterialKind::Metal;
+			else if (typeName == "dielectric" && parseFloat(p, ior)) kind = MaterialKind::Dielectric;
+			else if (typeName == "emissive" && parseVec3(p, color)) kind = MaterialKind::Emissive;
+			else return fail("unknown material type or bad parameters for '" + typeName + "'");
+			if (!atEnd(p)) return fail("unexpected text after material parameters");
+			std::string key(name, nameLength);
+			if (materials.count(key) != 0) return fail("material '" + key + "' is defined twice");
+			switch (kind) {
+			case MaterialKind::Lambertian: materials[key] = scene->addMaterial<Lambertian>(color); break;
+			case MaterialKind::Metal: materials[key] = scene->addMaterial<Metal>(color); break;
+			case MaterialKind::Emissive: materials[key] = scene->addMaterial<Emissive>(color); break;
+			default: materials[key] = scene->addMaterial<Dielectric>(ior); break;
+			}
+			lastMaterial = -1;
+		}
+		else if (n == 6 && std::memcmp(word, "camera", 6) == 0) {
+			View view;
+			if (!parseVec3(p, view.lookfrom) || !parseVec3(p, view.lookat) || !parseVec3(p, view.up) ||
+				!parseFloat(p, view.vfov) || !atEnd(p)) {
+				return fail("expected 'camera from(x y z) at(x y z) up(x y z) vfov'");
+			}
+			scene->view = view;
+			scene->setAspect(aspect);
+		}
+		else if (n == 3 && std::memcmp(word, "set", 3) == 0) {
+			const char* key;
+			size_t keyLength = nextWord(p, key);
+			const char* value;
+			size_t valueLength = nextWord(p, value);
+			if (keyLength == 0 || valueLength == 0 || !atEnd(p)) return fail("expected 'set key value'");
+			scene->settings.emplace_back(std::string(key, keyLength), std::string(value, valueLength));
+		}
+		else {
+			fail("unknown directive '" + std::string(word, n) + "'");
+		}
+	};
+
+	while (!failed) {
+		size_t read = std::fread(buffer.data() + carry, 1, CHUNK - carry, file);
+		size_t end = carry + read;
+		bool eof = read == 0;
+		if (eof && carry == 0) break;
+
+		size_t lineStart = 0;
+		for (size_t i = 0; i < end && !failed; i++) {
+			if (buffer[i] == '\n') {
+				buffer[i] = '\0';
+				parseLine(buffer.data() + lineStart);
+				lineStart = i + 1;
+			}
+		}
+		if (failed) break;
+		if (eof) {
+			// 文件末尾没有换行的最后一行
+			buffer[end] = '\0';
+			parseLine(buffer.data() + lineStart);
+			break;
+		}
+		carry = end - lineStart;
+		if (carry == CHUNK) {
+			number++;
+			fail("line too long");
+			break;
+		}
+		std::memmove(buffer.data(), buffer.data() + lineStart, carry);
+	}
+	std::fclose(file);
+	if (failed) return nullptr;
+	return scene;
+}
+
+// 映射场景缓存并重建其中的材质表，几何与 BVH 留在映射的文件中按需调页
+inline std::unique_ptr<Scene> loadSceneCache(const std::string& path, float aspect, std::string& error) {
+	std::unique_ptr<SceneCache> cache(new SceneCache());
+	if (!cache->open(path, error)) return nullptr;
+	std::unique_ptr<Scene> scene(new Scene(cache->view(), aspect));
+	for (int i = 0; i < cache->materialCount(); i++) {
+		const SceneCacheMaterial& record = cache->material(i);
+		glm::vec3 params(record.params[0], record.params[1], record.params[2]);
+		switch (MaterialKind(record.kind)) {
+		case MaterialKind::Lambertian: scene->addMaterial<Lambertian>(params); break;
+		case MaterialKind::Metal: scene->addMaterial<Metal>(params); break;
+		case MaterialKind::Dielectric: scene->addMaterial<Dielectric>(params.x); break;
+		case MaterialKind::Emissive: scene->addMaterial<Emissive>(params); break;
+		default:
+			error = path + ": unknown material kind " + std::to_string(record.kind);
+			return nullptr;
+		}
+	}
+	scene->settings = cache->settings();
+	scene->setCache(std::move(cache));
+	return scene;
+}
+
+// 按 method 构建场景的 BVH 并连同相机与渲染设置写成场景缓存
+inline bool writeSceneCache(const std::string& path, Scene& scene, BVHBuildMethod method, int threads,
+	std::string& error) {
+	BVH bvh = scene.buildBVH(method, threads);
+	return writeSceneCache(path, scene.view, bvh, scene.settings, error);
+}
+
+// 根据配置准备场景：指定了场景文件或场景缓存时加载它，并按"defaults < 场景文件中的设置 < 配置文件与命令行"的优先级
+// 重新生成 config；否则使用内置的随机场景。相机宽高比取最终的分辨率
+inline std::unique_ptr<Scene> prepareScene(int argc, char** argv, const RenderConfig& defaults,
+	RenderConfig& config, std::string& error) {
+	if (config.scene.empty()) return randomScene(float(config.width) / float(config.height));
+
+	std::unique_ptr<Scene> scene = SceneCache::probe(config.scene) ? loadSceneCache(config.scene, 1.0f, error) :
+		loadSceneFile(config.scene, 1.0f, error);
+	if (!scene) return nullptr;
+
+	RenderConfig merged = defaults;
+	for (const auto& setting : scene->settings) {
+		if (!applyConfigOption(merged, setting.first, setting.second, error)) {
+			error = config.scene + ": " + error;
+			return nullptr;
+		}
+	}
+	if (!parseCommandLine(argc, argv, merged, error)) return nullptr;
+	config = merged;
+	scene->setAspect(float(config.width) / float(config.height));
+	return scene;
+}
+
+#endif // !SCENE_LOADER_H
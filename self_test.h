@@ -0,0 +1,274 @@
+#ifndef SELF_TEST_H
+#define SELF_TEST_H
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+#include "ray.h"
+#include "simd.h"
+#include "sphere_soa.h"
+#include "bvh.h"
+#include "wide_bvh.h"
+#include "packet.h"
+#include "lights.h"
+#include "scene.h"
+
+namespace self_test_detail {
+
+// 最近交点与参考结果一致：命中同一个球体，且距离逐位相同
+inline bool sameHit(int hit, float minT, int refHit, float refT) {
+	if (hit != refHit) return false;
+	return hit < 0 || std::memcmp(&minT, &refT, sizeof(float)) == 0;
+}
+
+// anyHit 为负表示该查询没有任意交点版本
+inline void report(std::ostream& os, const std::string& name, int closest, int anyHit) {
+	os << std::setw(18) << name << std::setw(12) << closest;
+	if (anyHit >= 0) os << std::setw(12) << anyHit << std::endl;
+	else os << std::setw(12) << "-" << std::endl;
+}
+
+// 光线包与逐条光线的二叉 BVH 查询比对，返回不一致的车道数。以 rays 中每 8 条为一组：
+// 偶数组为相干包，8 条光线共用第一条的原点、方向在其附近扰动，可以走区间剔除；奇数组直接取 8 条不相干的光线。
+// 一半的包随机关掉部分车道，关掉的车道须保持未命中
+inline int checkPackets(const BVH& bvh, const std::vector<Ray>& rays, std::mt19937& gen) {
+	PacketTracer tracer(bvh);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	int mismatches = 0;
+	for (size_t base = 0; base + RayPacket::SIZE <= rays.size(); base += RayPacket::SIZE) {
+		bool coherent = (base / RayPacket::SIZE) % 2 == 0;
+		int mask = gen() % 2 == 0 ? 0xff : int(gen() % 255) + 1;
+		RayPacket packet;
+		Ray lanes[RayPacket::SIZE];
+		for (int i = 0; i < RayPacket::SIZE; i++) {
+			const Ray& ray = rays[base + i];
+			if (coherent) {
+				glm::vec3 jitter(distribution(gen), distribution(gen), distribution(gen));
+				lanes[i] = Ray::fromDirection(rays[base].origin(),
+					glm::normalize(rays[base].direction() + 0.02f * jitter));
+			}
+			else {
+				lanes[i] = ray;
+			}
+			if (mask & (1 << i)) packet.set(i, lanes[i]);
+		}
+		tracer.intersect(packet);
+		for (int i = 0; i < RayPacket::SIZE; i++) {
+			float refT = FLOAT_INF;
+			int refHit = -1;
+			if (mask & (1 << i)) refHit = bvh.intersectIndex(lanes[i], refT);
+			if (!sameHit(packet.hit[i], packet.tMax[i], refHit, refT)) mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+// 光源层次结构：在随机着色点上调用 sample()，检查 pdf() 对选中光源重算出的概率密度与 sample() 给出的一致。
+// 每 1000 个着色点再让 u 均匀扫过 [0, 1) 的 SWEEP 个位置统计各光源被选中的频率（最后一格为采样失败），
+// 与 pdf() 乘以立体角还原出的选择概率比较，总变差超过 0.01 记一次不一致
+inline void checkLights(const LightSet& lights, int points, std::mt19937& gen, int& pdfMismatches, int& pmfMismatches) {
+	const int SWEEP = 1 << 16;
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 0.99999994f);
+	std::vector<int> lightOf;
+	for (int l = 0; l < lights.size(); l++) {
+		int prim = lights.light(l).prim;
+		if (prim >= int(lightOf.size())) lightOf.resize(prim + 1, -1);
+		lightOf[prim] = l;
+	}
+	std::vector<int> counts(lights.size() + 1);
+	pdfMismatches = pmfMismatches = 0;
+	for (int i = 0; i < points; i++) {
+		// 着色点位于光源所在区域的下方，不会落进任何光源内部
+		glm::vec3 point(8.0f * distribution(gen), distribution(gen) - 2.0f, 8.0f * distribution(gen));
+		glm::vec3 normal = glm::normalize(glm::vec3(distribution(gen), distribution(gen), distribution(gen)));
+		LightSample sample;
+		if (lights.sample(point, normal, unit(gen), glm::vec2(unit(gen), unit(gen)), sample)) {
+			float pdf = lights.pdf(point, normal, sample.prim);
+			if (!(std::fabs(pdf - sample.pdf) <= 1e-4f * sample.pdf)) pdfMismatches++;
+		}
+		if (i % 1000 != 0) continue;
+
+		std::fill(counts.begin(), counts.end(), 0);
+		for (int k = 0; k < SWEEP; k++) {
+			bool sampled = lights.sample(point, normal, (k + 0.5f) / SWEEP, glm::vec2(0.5f), sample);
+			counts[sampled ? lightOf[sample.prim] : lights.size()]++;
+		}
+		double variation = 0.0, total = 0.0;
+		for (int l = 0; l < lights.size(); l++) {
+			const SphereLight& light = lights.light(l);
+			double pmf = double(lights.pdf(point, normal, light.prim)) * sphereSolidAngle(point, light.center, light.radius);
+			variation += std::fabs(pmf - double(counts[l]) / SWEEP);
+			total += pmf;
+		}
+		variation += std::fabs(1.0 - total - double(counts[lights.size()]) / SWEEP);
+		if (!(0.5 * variation <= 0.01)) pmfMismatches++;
+	}
+}
+
+// 分别以 SAH 与 LBVH 构建场景的 BVH，把二叉与 4/8 叉 BVH 的查询结果与逐个球体的标量求交比对，
+// 支持 AVX2 时再把光线包与逐条光线比对，并检查树深在 BVH::MAX_DEPTH 以内。全部一致时返回 true
+inline bool checkTraversal(std::ostream& os, const char* name, Scene& scene, const std::vector<Ray>& rays,
+	const std::vector<float>& tMax, std::mt19937& gen) {
+	bool passed = true;
+	const BVHBuildMethod methods[] = { BVHBuildMethod::SAH, BVHBuildMethod::LBVH };
+	const char* methodNames[] = { "SAH", "LBVH" };
+	for (int m = 0; m < 2; m++) {
+		BVH bvh = scene.buildBVH(methods[m]);
+		WideBVH wide4(bvh, 4);
+		std::unique_ptr<WideBVH> wide8(simdLevel() >= SimdLevel::AVX2 ? new WideBVH(bvh, 8) : nullptr);
+		int closest[3] = { 0 }, anyHit[3] = { 0 };
+		for (size_t i = 0; i < rays.size(); i++) {
+			float refT = FLOAT_INF, minT;
+			int refHit = -1;
+			bvh.spheres().intersectScalar(rays[i], 0, bvh.size(), refT, refHit);
+			bool refOccluded = bvh.spheres().occludedScalar(rays[i], 0, bvh.size(), tMax[i]);
+
+			int hit = bvh.intersectIndex(rays[i], minT);
+			if (!sameHit(hit, minT, refHit, refT)) closest[0]++;
+			if (bvh.occluded(rays[i], tMax[i]) != refOccluded) anyHit[0]++;
+			hit = wide4.intersectIndex(rays[i], minT);
+			if (!sameHit(hit, minT, refHit, refT)) closest[1]++;
+			if (wide4.occluded(rays[i], tMax[i]) != refOccluded) anyHit[1]++;
+			if (wide8) {
+				hit = wide8->intersectIndex(rays[i], minT);
+				if (!sameHit(hit, minT, refHit, refT)) closest[2]++;
+				if (wide8->occluded(rays[i], tMax[i]) != refOccluded) anyHit[2]++;
+			}
+		}
+		std::string prefix = std::string(name) + " " + methodNames[m];
+		const char* widths[] = { " BVH2", " BVH4", " BVH8" };
+		for (int w = 0; w < (wide8 ? 3 : 2); w++) {
+			report(os, prefix + widths[w], closest[w], anyHit[w]);
+			passed = passed && closest[w] == 0 && anyHit[w] == 0;
+		}
+		if (PacketTracer::supported()) {
+			int packets = checkPackets(bvh, rays, gen);
+			report(os, prefix + " packet", packets, -1);
+			passed = passed && packets == 0;
+		}
+		int depth = bvh.depth();
+		os << std::setw(18) << prefix << "    depth " << depth << " (limit " << BVH::MAX_DEPTH - 1 << ")" << std::endl;
+		passed = passed && depth < BVH::MAX_DEPTH;
+	}
+	return passed;
+}
+
+} // namespace self_test_detail
+
+// 自检：以逐个球体求交的标量实现为参考，在随机光线上比对本机支持的各个 SphereSoA 向量内核，
+// 以及 SAH / LBVH 构建的二叉与 4/8 叉 BVH 的最近交点和任意交点查询、8 条光线的光线包，输出各自的不一致次数。
+// 除内置随机场景外还有一个沿坐标轴按指数间隔排列的场景，检查两种构建器的树深上限；
+// 最后比对光源层次结构的 sample() 与 pdf()。全部一致时返回 true
+inline bool runSelfTest(std::ostream& os) {
+	using namespace self_test_detail;
+	const int RAYS = 100000;
+	std::mt19937 gen(2020);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	auto randomVec = [&]() { return glm::vec3(distribution(gen), distribution(gen), distribution(gen)); };
+
+	const SimdLevel level = simdLevel();
+	const char* levelNames[] = { "SSE", "AVX2", "AVX-512" };
+	os << "SELF TEST (" << levelNames[int(level)] << ", " << RAYS << " rays each)" << std::endl;
+	os << std::setw(18) << "" << std::setw(12) << "closest" << std::setw(12) << "any-hit" << std::endl;
+	bool passed = true;
+
+	// 向量内核：单位立方体内的 64 个球体，每条光线取一段随机长度的区间，覆盖各宽度的尾部掩码
+	const int SPHERES = 64;
+	SphereSoA soa;
+	soa.resize(SPHERES);
+	for (int i = 0; i < SPHERES; i++) {
+		soa.set(i, randomVec(), 0.1f + 0.15f * (distribution(gen) + 1.0f), 0);
+	}
+	std::vector<Ray> rays(RAYS);
+	std::vector<float> tMax(RAYS);
+	std::vector<int> starts(RAYS), ends(RAYS);
+	for (int i = 0; i < RAYS; i++) {
+		glm::vec3 origin = 2.0f * randomVec();
+		rays[i] = Ray::fromDirection(origin, glm::normalize(randomVec() - origin));
+		tMax[i] = 2.0f * (distribution(gen) + 1.0f);
+		starts[i] = int((distribution(gen) + 1.0f) * 0.5f * (SPHERES - 1));
+		ends[i] = std::min(SPHERES, starts[i] + 1 + int((distribution(gen) + 1.0f) * 24.0f));
+	}
+	for (int l = 0; l <= int(level); l++) {
+		int closest = 0, anyHit = 0;
+		for (int i = 0; i < RAYS; i++) {
+			float refT = tMax[i], minT = tMax[i];
+			int refHit = -1, hit = -1;
+			soa.intersectScalar(rays[i], starts[i], ends[i], refT, refHit);
+			soa.intersect(rays[i], starts[i], ends[i], minT, hit, SimdLevel(l));
+			if (!sameHit(hit, minT, refHit, refT)) closest++;
+			if (soa.occludedScalar(rays[i], starts[i], ends[i], tMax[i]) !=
+				soa.occluded(rays[i], starts[i], ends[i], tMax[i], SimdLevel(l))) {
+				anyHit++;
+			}
+		}
+		report(os, levelNames[l], closest, anyHit);
+		passed = passed && closest == 0 && anyHit == 0;
+	}
+
+	// BVH 遍历：内置随机场景，光线从地面上方的随机位置射向随机方向
+	std::unique_ptr<Scene> scene = randomScene(1.5f);
+	for (int i = 0; i < RAYS; i++) {
+		glm::vec3 origin(12.0f * distribution(gen), 2.0f * distribution(gen) + 2.1f, 12.0f * distribution(gen));
+		rays[i] = Ray::fromDirection(origin, glm::normalize(randomVec()));
+		tMax[i] = 8.0f * (distribution(gen) + 1.0f);
+	}
+	passed = checkTraversal(os, "random", *scene, rays, tMax, gen) && passed;
+
+	// 沿三个坐标轴按指数间隔排列的 23040 个球体，Morton 码划分会退化成长链。
+	// 球体多，光线数取五十分之一，从随机选取的球体附近射向它
+	std::unique_ptr<Scene> chain(new Scene(View(), 1.5f));
+	int material = chain->addMaterial<Lambertian>(glm::vec3(0.5f));
+	std::vector<glm::vec3> centers;
+	for (int axis = 0; axis < 3; axis++) {
+		float x = 1.0f;
+		for (int i = 0; i < 7680; i++, x *= 1.01f) {
+			glm::vec3 center(0.0f);
+			center[axis] = x;
+			chain->addSphere(center, 0.004f * x, material);
+			centers.push_back(center);
+		}
+	}
+	rays.resize(RAYS / 50);
+	tMax.resize(RAYS / 50);
+	std::uniform_int_distribution<int> pick(0, int(centers.size()) - 1);
+	for (size_t i = 0; i < rays.size(); i++) {
+		glm::vec3 center = centers[pick(gen)];
+		float scale = center.x + center.y + center.z;
+		glm::vec3 origin = center + 0.05f * scale * randomVec();
+		rays[i] = Ray::fromDirection(origin, glm::normalize(center + 0.003f * scale * randomVec() - origin));
+		tMax[i] = 0.05f * scale * (distribution(gen) + 1.0f);
+	}
+	passed = checkTraversal(os, "chain", *chain, rays, tMax, gen) && passed;
+
+	// 光源层次结构：地面上方随机分布的 2000 个发光球体，夹杂同样多的不发光球体
+	std::unique_ptr<Scene> lit(new Scene(View(), 1.5f));
+	int diffuse = lit->addMaterial<Lambertian>(glm::vec3(0.5f));
+	for (int i = 0; i < 4000; i++) {
+		glm::vec3 center(8.0f * distribution(gen), 2.0f * distribution(gen) + 3.0f, 8.0f * distribution(gen));
+		float radius = 0.02f + 0.05f * (distribution(gen) + 1.0f);
+		lit->addSphere(center, radius, i % 2 == 0 ? diffuse :
+			lit->addMaterial<Emissive>(glm::vec3(1.0f) + 4.0f * glm::abs(randomVec())));
+	}
+	BVH litBVH = lit->buildBVH(BVHBuildMethod::SAH);
+	LightSet lights(litBVH);
+	int pdfMismatches, pmfMismatches;
+	checkLights(lights, RAYS / 5, gen, pdfMismatches, pmfMismatches);
+	report(os, "light pdf", pdfMismatches, -1);
+	report(os, "light pmf", pmfMismatches, -1);
+	passed = passed && pdfMismatches == 0 && pmfMismatches == 0;
+
+	os << (passed ? "SELF TEST PASSED" : "SELF TEST FAILED") << std::endl;
+	return passed;
+}
+
+#endif // !SELF_TEST_H
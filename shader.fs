@@ -1,9 +1,10 @@
 #version 330 core
 
+in vec2 texCoord;
 out vec4 FragColor;
-uniform vec3 vertexColor;
+uniform sampler2D image;
 
 void main()
 {
-	FragColor = vec4(vertexColor, 1.0);
+	FragColor = vec4(texture(image, texCoord).rgb, 1.0);
 }
\ No newline at end of file
@@ -1,8 +1,11 @@
 #version 330 core
 
-uniform vec2 screenPos;
+out vec2 texCoord;
 
+// 由 gl_VertexID 生成覆盖整个屏幕的三角形，无需顶点缓冲
 void main()
 {
-    gl_Position = vec4(screenPos, -1.0, 1.0);
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    texCoord = pos;
+    gl_Position = vec4(pos * 2.0 - 1.0, 0.0, 1.0);
 }
\ No newline at end of file
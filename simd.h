@@ -0,0 +1,81 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC 允许在任意函数中使用对应指令集的 intrinsic，无需额外标注
+#define RT_TARGET_AVX2
+#define RT_TARGET_AVX512
+#elif defined(__clang__)
+#include <cpuid.h>
+#define RT_TARGET_AVX2 __attribute__((target("avx2")))
+#define RT_TARGET_AVX512 __attribute__((target("avx512f,avx2")))
+#else
+#include <cpuid.h>
+// avx512f 隐含 FMA，GCC 默认会把乘加合并为 FMA，导致与标量路径的结果不再逐位一致
+#define RT_TARGET_AVX2 __attribute__((target("avx2"), optimize("fp-contract=off")))
+#define RT_TARGET_AVX512 __attribute__((target("avx512f,avx2"), optimize("fp-contract=off")))
+#endif
+
+enum class SimdLevel {
+	SSE = 0,
+	AVX2 = 1,
+	AVX512 = 2
+};
+
+namespace simd_detail {
+
+inline void cpuid(int leaf, int subleaf, unsigned int regs[4]) {
+#ifdef _MSC_VER
+	int r[4];
+	__cpuidex(r, leaf, subleaf);
+	for (int i = 0; i < 4; i++) regs[i] = (unsigned int)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+inline unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+inline SimdLevel querySimdLevel() {
+	unsigned int regs[4];
+	cpuid(0, 0, regs);
+	unsigned int maxLeaf = regs[0];
+	if (maxLeaf < 7) return SimdLevel::SSE;
+
+	// 需要操作系统通过 XSAVE 保存 YMM/ZMM 寄存器状态
+	cpuid(1, 0, regs);
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx = (regs[2] & (1u << 28)) != 0;
+	bool fma = (regs[2] & (1u << 12)) != 0;
+	if (!osxsave || !avx || !fma) return SimdLevel::SSE;
+	unsigned long long xcr0 = xgetbv0();
+	if ((xcr0 & 0x6) != 0x6) return SimdLevel::SSE;
+
+	cpuid(7, 0, regs);
+	bool avx2 = (regs[1] & (1u << 5)) != 0;
+	bool avx512f = (regs[1] & (1u << 16)) != 0;
+	if (avx512f && (xcr0 & 0xe6) == 0xe6) return SimdLevel::AVX512;
+	if (avx2) return SimdLevel::AVX2;
+	return SimdLevel::SSE;
+}
+
+} // namespace simd_detail
+
+// 运行时通过 CPUID 检测可用的最高向量指令集，结果只计算一次
+inline SimdLevel simdLevel() {
+	static const SimdLevel level = simd_detail::querySimdLevel();
+	return level;
+}
+
+#endif // !SIMD_H
@@ -5,6 +5,7 @@
 #include <cmath>
 
 #include "ray.h"
+#include "aabb.h"
 
 class Material;
 
@@ -12,26 +13,32 @@ class Sphere {
 public:
 	Sphere(const glm::vec3& center, float radius, Material* material):
 		_center(center), _radius(radius), _material(material) {}
-	~Sphere() { delete _material; }
 	
 	glm::vec3 center() const { return _center; }
 	float radius() const { return _radius; }
 	Material* material() const { return _material; }
+	AABB bounds() const { return AABB(_center - glm::vec3(_radius), _center + glm::vec3(_radius)); }
 
 	float rayCollision(const Ray& ray) const {
-		glm::vec3 vc = ray.origin() - _center;
+		return rayCollision(_center, _radius, ray);
+	}
+
+	static float rayCollision(const glm::vec3& center, float radius, const Ray& ray) {
+		glm::vec3 vc = ray.origin() - center;
 
 		float A = glm::dot(ray.direction(), ray.direction());
 		float B = glm::dot(vc, ray.direction());
-		float C = glm::dot(vc, vc) - _radius * _radius;
+		float C = glm::dot(vc, vc) - radius * radius;
 		float discriminant = B * B - A * C;
 
+		// 单精度开方只做一次，SphereSoA 的向量化版本按完全相同的运算顺序逐位复现
 		if (discriminant > 0.0f) {
-			float t = (-B - sqrt(discriminant)) / A;
+			float root = std::sqrt(discriminant);
+			float t = (-B - root) / A;
 			if (t < FLOAT_INF && t > FLOAT_EPS) {
 				return t;
 			}
-			t = (-B + sqrt(discriminant)) / A;
+			t = (-B + root) / A;
 			if (t < FLOAT_INF && t > FLOAT_EPS) {
 				return t;
 			}
@@ -0,0 +1,293 @@
+#ifndef SPHERE_SOA_H
+#define SPHERE_SOA_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#include "ray.h"
+#include "sphere.h"
+#include "aligned.h"
+#include "simd.h"
+
+// 按 SoA 排列的球体数组：球心 x/y/z、半径和材质编号各自连续存放并按 64 字节对齐。
+// 数组末尾额外填充 PADDING 个元素，向量化内核读取尾部时无需越界检查。
+// 数据可以自己持有，也可以是外部内存（如内存映射的场景缓存）的只读视图
+class SphereSoA {
+public:
+	static constexpr int PADDING = 16;
+
+	SphereSoA() { resize(0); }
+
+	SphereSoA(const SphereSoA&) = delete;
+	SphereSoA& operator=(const SphereSoA&) = delete;
+	SphereSoA(SphereSoA&&) = default;
+	SphereSoA& operator=(SphereSoA&&) = default;
+
+	// 引用外部数组，每个数组须有 size + PADDING 个元素，且生命周期覆盖本对象
+	static SphereSoA view(const float* x, const float* y, const float* z, const float* r,
+		const int* material, int size) {
+		SphereSoA soa;
+		soa._ownX.clear();
+		soa._ownY.clear();
+		soa._ownZ.clear();
+		soa._ownR.clear();
+		soa._ownMaterial.clear();
+		soa._size = size;
+		soa._x = x;
+		soa._y = y;
+		soa._z = z;
+		soa._r = r;
+		soa._material = material;
+		return soa;
+	}
+
+	void resize(int size) {
+		_size = size;
+		_ownX.assign(size + PADDING, 0.0f);
+		_ownY.assign(size + PADDING, 0.0f);
+		_ownZ.assign(size + PADDING, 0.0f);
+		_ownR.assign(size + PADDING, 0.0f);
+		_ownMaterial.assign(size + PADDING, -1);
+		_x = _ownX.data();
+		_y = _ownY.data();
+		_z = _ownZ.data();
+		_r = _ownR.data();
+		_material = _ownMaterial.data();
+	}
+
+	// 只能用于自己持有数据的数组
+	void set(int i, const glm::vec3& center, float radius, int material) {
+		_ownX[i] = center.x;
+		_ownY[i] = center.y;
+		_ownZ[i] = center.z;
+		_ownR[i] = radius;
+		_ownMaterial[i] = material;
+	}
+
+	// 连续数组的首地址，长度均为 size() + PADDING
+	const float* xData() const { return _x; }
+	const float* yData() const { return _y; }
+	const float* zData() const { return _z; }
+	const float* radiusData() const { return _r; }
+	const int* materialData() const { return _material; }
+
+	int size() const { return _size; }
+	glm::vec3 center(int i) const { return glm::vec3(_x[i], _y[i], _z[i]); }
+	float radius(int i) const { return _r[i]; }
+	int material(int i) const { return _material[i]; }
+
+	// 在 [start, end) 内求最近交点，只有 t 小于传入的 minT 才会更新 minT 与 hit。
+	// 各内核与 Sphere::rayCollision 的运算顺序一致，命中结果逐位相同
+	void intersect(const Ray& ray, int start, int end, float& minT, int& hit) const {
+		dispatch<false>(ray, start, end, minT, hit, simdLevel());
+	}
+
+	// 任意交点查询：[start, end) 内是否有 FLOAT_EPS < t < tMax 的交点，找到一个即返回，不求最近者
+	bool occluded(const Ray& ray, int start, int end, float tMax) const {
+		int hit = -1;
+		dispatch<true>(ray, start, end, tMax, hit, simdLevel());
+		return hit >= 0;
+	}
+
+	// 指定内核的版本，level 不能高于 simdLevel()，供自检逐个比对各指令集
+	void intersect(const Ray& ray, int start, int end, float& minT, int& hit, SimdLevel level) const {
+		dispatch<false>(ray, start, end, minT, hit, level);
+	}
+
+	bool occluded(const Ray& ray, int start, int end, float tMax, SimdLevel level) const {
+		int hit = -1;
+		dispatch<true>(ray, start, end, tMax, hit, level);
+		return hit >= 0;
+	}
+
+	// 逐个球体求交的参考实现，--self-test 以它为准检查向量内核与 BVH 遍历
+	void intersectScalar(const Ray& ray, int start, int end, float& minT, int& hit) const {
+		for (int i = start; i < end; i++) {
+			float t = Sphere::rayCollision(center(i), _r[i], ray);
+			if (t > FLOAT_EPS && t < minT) {
+				minT = t;
+				hit = i;
+			}
+		}
+	}
+
+	bool occludedScalar(const Ray& ray, int start, int end, float tMax) const {
+		for (int i = start; i < end; i++) {
+			float t = Sphere::rayCollision(center(i), _r[i], ray);
+			if (t > FLOAT_EPS && t < tMax) return true;
+		}
+		return false;
+	}
+
+private:
+	// AnyHit 为 true 时各内核在第一组含有 t < minT 的车道处返回，hit 置为其中一个球体，minT 不变
+	template <bool AnyHit>
+	void dispatch(const Ray& ray, int start, int end, float& minT, int& hit, SimdLevel level) const {
+		int count = end - start;
+		if (count <= 0) return;
+		if (count <= 4) {
+			intersect4<AnyHit>(ray, start, end, minT, hit);
+			return;
+		}
+		switch (level) {
+		case SimdLevel::AVX512: intersect16<AnyHit>(ray, start, end, minT, hit); break;
+		case SimdLevel::AVX2: intersect8<AnyHit>(ray, start, end, minT, hit); break;
+		default: intersect4<AnyHit>(ray, start, end, minT, hit); break;
+		}
+	}
+
+	static int lowestLane(int mask) {
+		int lane = 0;
+		while (!(mask & (1 << lane))) lane++;
+		return lane;
+	}
+
+	// 按车道顺序以严格小于比较更新最近交点，与标量循环的选择规则一致
+	static void selectClosest(const float* t, int mask, int base, float& minT, int& hit) {
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if ((mask & 1) && t[lane] < minT) {
+				minT = t[lane];
+				hit = base + lane;
+			}
+		}
+	}
+
+	template <bool AnyHit>
+	void intersect4(const Ray& ray, int start, int end, float& minT, int& hit) const {
+		glm::vec3 o = ray.origin(), d = ray.direction();
+		float a = glm::dot(d, d);
+		__m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+		__m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+		__m128 A = _mm_set1_ps(a);
+		__m128 zero = _mm_setzero_ps();
+		__m128 eps = _mm_set1_ps(FLOAT_EPS), inf = _mm_set1_ps(FLOAT_INF);
+		alignas(16) float t[4];
+
+		for (int base = start; base < end; base += 4) {
+			__m128 vx = _mm_sub_ps(ox, _mm_loadu_ps(&_x[base]));
+			__m128 vy = _mm_sub_ps(oy, _mm_loadu_ps(&_y[base]));
+			__m128 vz = _mm_sub_ps(oz, _mm_loadu_ps(&_z[base]));
+			__m128 r = _mm_loadu_ps(&_r[base]);
+			__m128 B = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy)), _mm_mul_ps(vz, dz));
+			__m128 C = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)),
+				_mm_mul_ps(r, r));
+			__m128 disc = _mm_sub_ps(_mm_mul_ps(B, B), _mm_mul_ps(A, C));
+			__m128 root = _mm_sqrt_ps(disc);
+			__m128 negB = _mm_sub_ps(zero, B);
+			__m128 t0 = _mm_div_ps(_mm_sub_ps(negB, root), A);
+			__m128 t1 = _mm_div_ps(_mm_add_ps(negB, root), A);
+			__m128 ok0 = _mm_and_ps(_mm_cmplt_ps(t0, inf), _mm_cmpgt_ps(t0, eps));
+			__m128 ok1 = _mm_and_ps(_mm_cmplt_ps(t1, inf), _mm_cmpgt_ps(t1, eps));
+			__m128 tv = _mm_or_ps(_mm_and_ps(ok0, t0), _mm_andnot_ps(ok0, t1));
+			__m128 valid = _mm_and_ps(_mm_cmpgt_ps(disc, zero), _mm_or_ps(ok0, ok1));
+
+			int mask = _mm_movemask_ps(valid);
+			if (end - base < 4) mask &= (1 << (end - base)) - 1;
+			if (AnyHit) mask &= _mm_movemask_ps(_mm_cmplt_ps(tv, _mm_set1_ps(minT)));
+			if (mask == 0) continue;
+			if (AnyHit) {
+				hit = base + lowestLane(mask);
+				return;
+			}
+			_mm_store_ps(t, tv);
+			selectClosest(t, mask, base, minT, hit);
+		}
+	}
+
+	template <bool AnyHit>
+	RT_TARGET_AVX2 void intersect8(const Ray& ray, int start, int end, float& minT, int& hit) const {
+		glm::vec3 o = ray.origin(), d = ray.direction();
+		float a = glm::dot(d, d);
+		__m256 ox = _mm256_set1_ps(o.x), oy = _mm256_set1_ps(o.y), oz = _mm256_set1_ps(o.z);
+		__m256 dx = _mm256_set1_ps(d.x), dy = _mm256_set1_ps(d.y), dz = _mm256_set1_ps(d.z);
+		__m256 A = _mm256_set1_ps(a);
+		__m256 zero = _mm256_setzero_ps();
+		__m256 eps = _mm256_set1_ps(FLOAT_EPS), inf = _mm256_set1_ps(FLOAT_INF);
+		alignas(32) float t[8];
+
+		for (int base = start; base < end; base += 8) {
+			__m256 vx = _mm256_sub_ps(ox, _mm256_loadu_ps(&_x[base]));
+			__m256 vy = _mm256_sub_ps(oy, _mm256_loadu_ps(&_y[base]));
+			__m256 vz = _mm256_sub_ps(oz, _mm256_loadu_ps(&_z[base]));
+			__m256 r = _mm256_loadu_ps(&_r[base]);
+			__m256 B = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, dx), _mm256_mul_ps(vy, dy)),
+				_mm256_mul_ps(vz, dz));
+			__m256 C = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+				_mm256_mul_ps(vz, vz)), _mm256_mul_ps(r, r));
+			__m256 disc = _mm256_sub_ps(_mm256_mul_ps(B, B), _mm256_mul_ps(A, C));
+			__m256 root = _mm256_sqrt_ps(disc);
+			__m256 negB = _mm256_sub_ps(zero, B);
+			__m256 t0 = _mm256_div_ps(_mm256_sub_ps(negB, root), A);
+			__m256 t1 = _mm256_div_ps(_mm256_add_ps(negB, root), A);
+			__m256 ok0 = _mm256_and_ps(_mm256_cmp_ps(t0, inf, _CMP_LT_OQ), _mm256_cmp_ps(t0, eps, _CMP_GT_OQ));
+			__m256 ok1 = _mm256_and_ps(_mm256_cmp_ps(t1, inf, _CMP_LT_OQ), _mm256_cmp_ps(t1, eps, _CMP_GT_OQ));
+			__m256 tv = _mm256_blendv_ps(t1, t0, ok0);
+			__m256 valid = _mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GT_OQ), _mm256_or_ps(ok0, ok1));
+
+			int mask = _mm256_movemask_ps(valid);
+			if (end - base < 8) mask &= (1 << (end - base)) - 1;
+			if (AnyHit) mask &= _mm256_movemask_ps(_mm256_cmp_ps(tv, _mm256_set1_ps(minT), _CMP_LT_OQ));
+			if (mask == 0) continue;
+			if (AnyHit) {
+				hit = base + lowestLane(mask);
+				return;
+			}
+			_mm256_store_ps(t, tv);
+			selectClosest(t, mask, base, minT, hit);
+		}
+	}
+
+	template <bool AnyHit>
+	RT_TARGET_AVX512 void intersect16(const Ray& ray, int start, int end, float& minT, int& hit) const {
+		glm::vec3 o = ray.origin(), d = ray.direction();
+		float a = glm::dot(d, d);
+		__m512 ox = _mm512_set1_ps(o.x), oy = _mm512_set1_ps(o.y), oz = _mm512_set1_ps(o.z);
+		__m512 dx = _mm512_set1_ps(d.x), dy = _mm512_set1_ps(d.y), dz = _mm512_set1_ps(d.z);
+		__m512 A = _mm512_set1_ps(a);
+		__m512 zero = _mm512_setzero_ps();
+		__m512 eps = _mm512_set1_ps(FLOAT_EPS), inf = _mm512_set1_ps(FLOAT_INF);
+		alignas(64) float t[16];
+
+		for (int base = start; base < end; base += 16) {
+			__m512 vx = _mm512_sub_ps(ox, _mm512_loadu_ps(&_x[base]));
+			__m512 vy = _mm512_sub_ps(oy, _mm512_loadu_ps(&_y[base]));
+			__m512 vz = _mm512_sub_ps(oz, _mm512_loadu_ps(&_z[base]));
+			__m512 r = _mm512_loadu_ps(&_r[base]);
+			__m512 B = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(vx, dx), _mm512_mul_ps(vy, dy)),
+				_mm512_mul_ps(vz, dz));
+			__m512 C = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(vx, vx), _mm512_mul_ps(vy, vy)),
+				_mm512_mul_ps(vz, vz)), _mm512_mul_ps(r, r));
+			__m512 disc = _mm512_sub_ps(_mm512_mul_ps(B, B), _mm512_mul_ps(A, C));
+			__m512 root = _mm512_sqrt_ps(disc);
+			__m512 negB = _mm512_sub_ps(zero, B);
+			__m512 t0 = _mm512_div_ps(_mm512_sub_ps(negB, root), A);
+			__m512 t1 = _mm512_div_ps(_mm512_add_ps(negB, root), A);
+			__mmask16 ok0 = _mm512_cmp_ps_mask(t0, inf, _CMP_LT_OQ) & _mm512_cmp_ps_mask(t0, eps, _CMP_GT_OQ);
+			__mmask16 ok1 = _mm512_cmp_ps_mask(t1, inf, _CMP_LT_OQ) & _mm512_cmp_ps_mask(t1, eps, _CMP_GT_OQ);
+			__m512 tv = _mm512_mask_blend_ps(ok0, t1, t0);
+			int mask = _mm512_cmp_ps_mask(disc, zero, _CMP_GT_OQ) & (ok0 | ok1);
+
+			if (end - base < 16) mask &= (1 << (end - base)) - 1;
+			if (AnyHit) mask &= _mm512_cmp_ps_mask(tv, _mm512_set1_ps(minT), _CMP_LT_OQ);
+			if (mask == 0) continue;
+			if (AnyHit) {
+				hit = base + lowestLane(mask);
+				return;
+			}
+			_mm512_store_ps(t, tv);
+			selectClosest(t, mask, base, minT, hit);
+		}
+	}
+
+	int _size;
+	const float* _x;
+	const float* _y;
+	const float* _z;
+	const float* _r;
+	const int* _material;
+	AlignedVector<float, 64> _ownX, _ownY, _ownZ, _ownR;
+	AlignedVector<int, 64> _ownMaterial;
+};
+
+#endif // !SPHERE_SOA_H
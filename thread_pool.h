@@ -0,0 +1,84 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+#include "parallel.h"
+
+// 常驻线程池：run(job) 让每个工作线程各执行一次 job(thread)，全部返回后 run 才返回。
+// 线程在多次 run 之间复用，避免每个采样轮次都重新创建线程
+class ThreadPool {
+public:
+	// threads 为 0 时使用全部硬件线程；调用 run 的线程本身作为 0 号线程参与工作
+	explicit ThreadPool(int threads = 0) : _threads(threads > 0 ? threads : hardwareThreads()) {
+		for (int t = 1; t < _threads; t++) {
+			_workers.emplace_back([this, t]() { workerLoop(t); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (std::thread& worker : _workers) worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	int size() const { return _threads; }
+
+	void run(const std::function<void(int)>& job) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_job = &job;
+			_pending = _threads - 1;
+			_generation++;
+		}
+		_wake.notify_all();
+		job(0);
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [this]() { return _pending == 0; });
+		_job = nullptr;
+	}
+
+private:
+	void workerLoop(int thread) {
+		unsigned long long seen = 0;
+		while (true) {
+			const std::function<void(int)>* job;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait(lock, [&]() { return _stop || _generation != seen; });
+				if (_stop) return;
+				seen = _generation;
+				job = _job;
+			}
+			(*job)(thread);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_pending--;
+			}
+			_done.notify_one();
+		}
+	}
+
+	int _threads;
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	const std::function<void(int)>* _job = nullptr;
+	unsigned long long _generation = 0;
+	int _pending = 0;
+	bool _stop = false;
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,81 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include "thread_pool.h"
+#include "aligned.h"
+
+struct Tile {
+	int x0, y0;  // 左下角像素（含）
+	int x1, y1;  // 右上角像素（不含）
+};
+
+// 把画面划分为 tileSize x tileSize 的块，分发给线程池渲染。
+// 每个线程预先分得一段连续的块，用原子计数器无锁地领取；自己的块领完后轮流从其他线程的
+// 剩余块中窃取，领取与窃取都是同一个 fetch_add，因此任何块都不会被处理两次
+class TileScheduler {
+public:
+	TileScheduler(int width, int height, int tileSize = 16, int threads = 0) :
+		_width(width), _height(height), _tileSize(tileSize), _pool(threads) {
+		for (int y = 0; y < height; y += tileSize) {
+			for (int x = 0; x < width; x += tileSize) {
+				_tiles.push_back({ x, y, std::min(x + tileSize, width), std::min(y + tileSize, height) });
+			}
+		}
+		_all.resize(_tiles.size());
+		for (size_t i = 0; i < _all.size(); i++) _all[i] = int(i);
+		_queues = AlignedVector<Queue, 64>(_pool.size());
+	}
+
+	int width() const { return _width; }
+	int height() const { return _height; }
+	int tileSize() const { return _tileSize; }
+	int threads() const { return _pool.size(); }
+	const std::vector<Tile>& tiles() const { return _tiles; }
+
+	// 渲染一轮：对每个块调用一次 fn(tile, thread)，所有块完成后返回
+	void render(const std::function<void(const Tile&, int)>& fn) { render(_all, fn); }
+
+	// 只渲染 tiles 中列出的块（tiles() 的下标），用于自适应采样时跳过已收敛的块
+	void render(const std::vector<int>& tiles, const std::function<void(const Tile&, int)>& fn) {
+		int threadCount = _pool.size();
+		int tileCount = int(tiles.size());
+		for (int t = 0; t < threadCount; t++) {
+			_queues[t].begin = int((long long)tileCount * t / threadCount);
+			_queues[t].end = int((long long)tileCount * (t + 1) / threadCount);
+			_queues[t].next.store(_queues[t].begin, std::memory_order_relaxed);
+		}
+		_pool.run([&](int thread) {
+			for (int k = 0; k < threadCount; k++) {
+				Queue& queue = _queues[(thread + k) % threadCount];
+				while (true) {
+					int tile = queue.next.fetch_add(1, std::memory_order_relaxed);
+					if (tile >= queue.end) break;
+					fn(_tiles[tiles[tile]], thread);
+				}
+			}
+		});
+	}
+
+private:
+	// 独占缓存行，避免不同线程的计数器互相伪共享
+	struct alignas(64) Queue {
+		std::atomic<int> next{ 0 };
+		int begin = 0;
+		int end = 0;
+	};
+
+	int _width;
+	int _height;
+	int _tileSize;
+	ThreadPool _pool;
+	std::vector<Tile> _tiles;
+	std::vector<int> _all;
+	AlignedVector<Queue, 64> _queues;
+};
+
+#endif // !TILE_SCHEDULER_H
@@ -0,0 +1,180 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <utility>
+#include <initializer_list>
+
+#include "ray.h"
+#include "camera.h"
+#include "material.h"
+#include "wide_bvh.h"
+#include "sampler.h"
+#include "integrator.h"
+#include "tile_scheduler.h"
+#include "aligned.h"
+
+// 以 SoA 形式保存的一批路径状态：当前光线、通量、上一次散射的概率密度与交点法线、所属像素与各自的采样器
+class PathQueue {
+public:
+	int size() const { return _size; }
+	void clear() { _size = 0; }
+
+	void reserve(int capacity) {
+		if (capacity <= int(_pixel.size())) return;
+		for (AlignedVector<float, 64>* v : { &_ox, &_oy, &_oz, &_dx, &_dy, &_dz, &_tx, &_ty, &_tz,
+			&_pdf, &_nx, &_ny, &_nz }) {
+			v->resize(capacity);
+		}
+		_pixel.resize(capacity);
+		_sampler.resize(capacity);
+	}
+
+	void push(const Ray& ray, const glm::vec3& throughput, const MISState& mis, int pixel, const Sampler& sampler) {
+		int i = _size++;
+		glm::vec3 o = ray.origin(), d = ray.direction();
+		_ox[i] = o.x; _oy[i] = o.y; _oz[i] = o.z;
+		_dx[i] = d.x; _dy[i] = d.y; _dz[i] = d.z;
+		_tx[i] = throughput.x; _ty[i] = throughput.y; _tz[i] = throughput.z;
+		_pdf[i] = mis.bsdfPdf;
+		_nx[i] = mis.normal.x; _ny[i] = mis.normal.y; _nz[i] = mis.normal.z;
+		_pixel[i] = pixel;
+		_sampler[i] = sampler;
+	}
+
+	Ray ray(int i) const {
+		return Ray::fromDirection(glm::vec3(_ox[i], _oy[i], _oz[i]), glm::vec3(_dx[i], _dy[i], _dz[i]));
+	}
+	glm::vec3 throughput(int i) const { return glm::vec3(_tx[i], _ty[i], _tz[i]); }
+	MISState mis(int i) const {
+		MISState state;
+		state.bsdfPdf = _pdf[i];
+		state.normal = glm::vec3(_nx[i], _ny[i], _nz[i]);
+		return state;
+	}
+	int pixel(int i) const { return _pixel[i]; }
+	Sampler& sampler(int i) { return _sampler[i]; }
+
+private:
+	int _size = 0;
+	AlignedVector<float, 64> _ox, _oy, _oz;
+	AlignedVector<float, 64> _dx, _dy, _dz;
+	AlignedVector<float, 64> _tx, _ty, _tz;
+	AlignedVector<float, 64> _pdf;
+	AlignedVector<float, 64> _nx, _ny, _nz;
+	std::vector<int> _pixel;
+	std::vector<Sampler> _sampler;
+};
+
+// 波前（光线流）积分器：一次处理一个块内的全部路径，按阶段推进——生成相机光线、
+// 求最近交点、按材质类型分组、成批着色并把存活的路径压缩进下一轮队列。
+// 每条路径的采样器随路径一起存放，消耗随机数的顺序与 tracePath 相同，因此结果与逐像素积分器逐位一致。
+// 每个渲染线程持有一个实例，队列在块之间复用，不做重复分配
+class WavefrontIntegrator {
+public:
+	// 渲染块 tile 的第 sample 个采样（从 0 开始），radiance 按块内自下而上逐行顺序写出线性辐亮度
+	void render(const Tile& tile, int width, int height, int sample, const Camera& camera,
+		const WideBVH& bvh, const LightSet& lights, const Sampler& baseSampler, const IntegratorSettings& settings,
+		glm::vec3* radiance, int& segments) {
+		int tileWidth = tile.x1 - tile.x0;
+		int count = tileWidth * (tile.y1 - tile.y0);
+		_current.reserve(count);
+		_next.reserve(count);
+		_hitT.resize(count);
+		_hitPrim.resize(count);
+		_order.resize(count);
+
+		// 生成相机光线
+		_current.clear();
+		Sampler sampler = baseSampler;
+		for (int j = tile.y0; j < tile.y1; j++) {
+			for (int i = tile.x0; i < tile.x1; i++) {
+				int local = (j - tile.y0) * tileWidth + (i - tile.x0);
+				radiance[local] = glm::vec3(0.0f);
+				sampler.startPixelSample(i, j, width, uint32_t(sample));
+				_current.push(camera.get_ray(i, j, width, height, sampler), glm::vec3(1.0f), MISState(), local, sampler);
+			}
+		}
+
+		const BVH& binary = bvh.binary();
+		for (int depth = 0; _current.size() > 0; depth++) {
+			int n = _current.size();
+			segments += n;
+
+			// 求最近交点；未命中与击中发光球体的路径在此结算并终止（命中下标记为 -1，不参与着色）
+			for (int k = 0; k < n; k++) {
+				int prim = bvh.intersectIndex(_current.ray(k), _hitT[k]);
+				_hitPrim[k] = prim;
+				if (prim < 0) {
+					radiance[_current.pixel(k)] += _current.throughput(k) * background(_current.ray(k), settings);
+				}
+				else if (kindOf(binary, prim) == MaterialKind::Emissive) {
+					radiance[_current.pixel(k)] += _current.throughput(k) * emittedRadiance(
+						static_cast<Emissive*>(binary.material(prim)), _current.ray(k), prim, binary.spheres().center(prim),
+						_hitT[k], _current.mis(k), lights);
+					_hitPrim[k] = -1;
+				}
+			}
+			if (depth >= settings.maxDepth) break;
+
+			// 按材质类型计数排序，同类材质的命中点连续存放
+			int offsets[int(MaterialKind::Count) + 1] = {};
+			for (int k = 0; k < n; k++) {
+				if (_hitPrim[k] >= 0) offsets[int(kindOf(binary, _hitPrim[k])) + 1]++;
+			}
+			for (int m = 0; m < int(MaterialKind::Count); m++) offsets[m + 1] += offsets[m];
+			for (int k = 0; k < n; k++) {
+				if (_hitPrim[k] >= 0) _order[offsets[int(kindOf(binary, _hitPrim[k]))]++] = k;
+			}
+
+			// 成批着色：每段内材质类型相同，散射调用是非虚的，可以内联
+			_next.clear();
+			int begin = 0;
+			for (int m = 0; m < int(MaterialKind::Count); m++) {
+				int end = offsets[m];
+				switch (MaterialKind(m)) {
+				case MaterialKind::Lambertian: shade<Lambertian>(bvh, lights, begin, end, depth, settings, radiance, segments); break;
+				case MaterialKind::Metal: shade<Metal>(bvh, lights, begin, end, depth, settings, radiance, segments); break;
+				case MaterialKind::Dielectric: shade<Dielectric>(bvh, lights, begin, end, depth, settings, radiance, segments); break;
+				default: break;
+				}
+				begin = end;
+			}
+			std::swap(_current, _next);
+		}
+	}
+
+private:
+	static MaterialKind kindOf(const BVH& binary, int prim) {
+		return binary.material(prim)->kind();
+	}
+
+	template <typename M>
+	void shade(const WideBVH& bvh, const LightSet& lights, int begin, int end, int depth,
+		const IntegratorSettings& settings, glm::vec3* radiance, int& segments) {
+		const BVH& binary = bvh.binary();
+		for (int s = begin; s < end; s++) {
+			int k = _order[s];
+			M* material = static_cast<M*>(binary.material(_hitPrim[k]));
+			Sampler& sampler = _current.sampler(k);
+			Ray ray = _current.ray(k);
+			glm::vec3 throughput = _current.throughput(k);
+			glm::vec3 direct(0.0f);
+			MISState mis;
+			bool alive = scatterVertex(material, ray, _hitPrim[k], _hitT[k], depth, bvh, lights, sampler, settings,
+				throughput, mis, direct, segments);
+			radiance[_current.pixel(k)] += direct;
+			if (alive) _next.push(ray, throughput, mis, _current.pixel(k), sampler);
+		}
+	}
+
+	PathQueue _current;
+	PathQueue _next;
+	AlignedVector<float, 64> _hitT;
+	std::vector<int> _hitPrim;
+	std::vector<int> _order;
+};
+
+#endif // !WAVEFRONT_H
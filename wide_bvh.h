@@ -0,0 +1,251 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#include "ray.h"
+#include "aabb.h"
+#include "sphere.h"
+#include "bvh.h"
+#include "aligned.h"
+#include "simd.h"
+
+// N 叉 BVH 节点，N 个子节点的包围盒按 SoA 排列，一次 SIMD slab 测试即可覆盖全部子节点
+template <int N>
+struct alignas(32) WideBVHNode {
+	float minX[N], minY[N], minZ[N];
+	float maxX[N], maxY[N], maxZ[N];
+	int child[N];  // 内部子节点为节点下标，叶子为首个球体下标，空槽为 -1
+	int count[N];  // 叶子包含的球体个数，内部子节点为 0
+};
+
+// 由二叉 BVH 坍缩得到的 4 叉（SSE）或 8 叉（AVX2）BVH，宽度在运行时根据 CPUID 选择。
+// 叶子直接引用二叉 BVH 中按叶子顺序排列的球体，因此二叉 BVH 的生命周期必须覆盖本对象
+class WideBVH {
+public:
+	static constexpr int STACK_SIZE = 512;
+
+	// width 为 0 时自动选择：支持 AVX2 则为 8，否则为 4
+	explicit WideBVH(const BVH& bvh, int width = 0) : _bvh(bvh) {
+		if (width == 0) width = simdLevel() >= SimdLevel::AVX2 ? 8 : 4;
+		_width = width == 8 ? 8 : 4;
+		if (bvh.nodeCount() == 0) return;
+		if (_width == 8) collapse(0, _nodes8);
+		else collapse(0, _nodes4);
+	}
+
+	int width() const { return _width; }
+	const BVH& binary() const { return _bvh; }
+
+	// 返回命中球体在二叉 BVH 叶子顺序中的下标，未命中为 -1
+	int intersectIndex(const Ray& ray, float& minT) const {
+		minT = FLOAT_INF;
+		if (_width == 8) return _nodes8.empty() ? -1 : traverse8<false>(ray, minT);
+		return _nodes4.empty() ? -1 : traverse4<false>(ray, minT);
+	}
+
+	// 任意交点查询：光线在 (FLOAT_EPS, tMax) 内是否被遮挡，接口与 BVH::occluded 一致
+	bool occluded(const Ray& ray, float tMax) const {
+		if (_width == 8) return !_nodes8.empty() && traverse8<true>(ray, tMax) >= 0;
+		return !_nodes4.empty() && traverse4<true>(ray, tMax) >= 0;
+	}
+
+private:
+	struct StackEntry {
+		int node;
+		float t;
+	};
+
+	template <int N>
+	int collapse(int root, AlignedVector<WideBVHNode<N>>& nodes) {
+		const LinearBVHNode* binary = _bvh.nodes();
+
+		// 不断展开表面积最大的内部节点，直到凑满 N 个子节点
+		int slots[N];
+		int used = 0;
+		if (binary[root].count > 0) {
+			slots[used++] = root;
+		}
+		else {
+			slots[used++] = root + 1;
+			slots[used++] = binary[root].offset;
+		}
+		while (used < N) {
+			int best = -1;
+			float bestArea = -1.0f;
+			for (int i = 0; i < used; i++) {
+				const LinearBVHNode& node = binary[slots[i]];
+				if (node.count > 0) continue;
+				float area = AABB(node.min, node.max).surfaceArea();
+				if (area > bestArea) {
+					bestArea = area;
+					best = i;
+				}
+			}
+			if (best < 0) break;
+			int expanded = slots[best];
+			slots[best] = expanded + 1;
+			slots[used++] = binary[expanded].offset;
+		}
+
+		int index = int(nodes.size());
+		nodes.push_back(WideBVHNode<N>());
+		for (int i = 0; i < N; i++) {
+			if (i < used) {
+				const LinearBVHNode& node = binary[slots[i]];
+				nodes[index].minX[i] = node.min.x;
+				nodes[index].minY[i] = node.min.y;
+				nodes[index].minZ[i] = node.min.z;
+				nodes[index].maxX[i] = node.max.x;
+				nodes[index].maxY[i] = node.max.y;
+				nodes[index].maxZ[i] = node.max.z;
+				nodes[index].count[i] = node.count;
+				nodes[index].child[i] = node.count > 0 ? node.offset : -1;
+			}
+			else {
+				// 空槽的包围盒为空集，slab 测试恒不命中
+				nodes[index].minX[i] = nodes[index].minY[i] = nodes[index].minZ[i] = FLOAT_INF;
+				nodes[index].maxX[i] = nodes[index].maxY[i] = nodes[index].maxZ[i] = -FLOAT_INF;
+				nodes[index].count[i] = 0;
+				nodes[index].child[i] = -1;
+			}
+		}
+		for (int i = 0; i < used; i++) {
+			if (binary[slots[i]].count == 0) {
+				int child = collapse(slots[i], nodes);
+				nodes[index].child[i] = child;
+			}
+		}
+		return index;
+	}
+
+	// 处理一个节点的命中掩码：叶子立即求交，内部节点按进入距离从远到近入栈。
+	// AnyHit 为 true 时叶子只做遮挡测试，内部节点不排序，返回 true 表示已找到交点、遍历可以结束
+	template <bool AnyHit, int N>
+	bool visitChildren(const Ray& ray, const WideBVHNode<N>& node, int mask, const float* tEnter,
+		StackEntry* stack, int& top, float& minT, int& hit) const {
+		int start = top;
+		while (mask != 0) {
+			int i = lowestBit(mask);
+			mask &= mask - 1;
+			if (node.count[i] > 0) {
+				if (!AnyHit) {
+					_bvh.spheres().intersect(ray, node.child[i], node.child[i] + node.count[i], minT, hit);
+				}
+				else if (_bvh.spheres().occluded(ray, node.child[i], node.child[i] + node.count[i], minT)) {
+					hit = node.child[i];
+					return true;
+				}
+			}
+			else if (AnyHit) {
+				stack[top++] = { node.child[i], tEnter[i] };
+			}
+			else {
+				StackEntry entry = { node.child[i], tEnter[i] };
+				int j = top++;
+				while (j > start && stack[j - 1].t < entry.t) {
+					stack[j] = stack[j - 1];
+					j--;
+				}
+				stack[j] = entry;
+			}
+		}
+		return false;
+	}
+
+	static int lowestBit(int mask) {
+		int i = 0;
+		while (!(mask & (1 << i))) i++;
+		return i;
+	}
+
+	template <bool AnyHit>
+	int traverse4(const Ray& ray, float& minT) const {
+		glm::vec3 invDir = 1.0f / ray.direction();
+		__m128 ox = _mm_set1_ps(ray.origin().x);
+		__m128 oy = _mm_set1_ps(ray.origin().y);
+		__m128 oz = _mm_set1_ps(ray.origin().z);
+		__m128 ix = _mm_set1_ps(invDir.x);
+		__m128 iy = _mm_set1_ps(invDir.y);
+		__m128 iz = _mm_set1_ps(invDir.z);
+		__m128 eps = _mm_set1_ps(FLOAT_EPS);
+		bool negX = invDir.x < 0.0f, negY = invDir.y < 0.0f, negZ = invDir.z < 0.0f;
+
+		StackEntry stack[STACK_SIZE];
+		int top = 0;
+		int hit = -1;
+		stack[top++] = { 0, 0.0f };
+		while (top > 0) {
+			StackEntry entry = stack[--top];
+			if (entry.t > minT) continue;
+			const WideBVHNode<4>& node = _nodes4[entry.node];
+
+			// 按方向符号选取近、远平面，空槽（min > max）因此恒不命中
+			__m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negX ? node.maxX : node.minX), ox), ix);
+			__m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negX ? node.minX : node.maxX), ox), ix);
+			__m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negY ? node.maxY : node.minY), oy), iy);
+			__m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negY ? node.minY : node.maxY), oy), iy);
+			__m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negZ ? node.maxZ : node.minZ), oz), iz);
+			__m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(negZ ? node.minZ : node.maxZ), oz), iz);
+			__m128 enter = _mm_max_ps(_mm_max_ps(tx0, ty0), _mm_max_ps(tz0, eps));
+			__m128 exit = _mm_min_ps(_mm_min_ps(tx1, ty1), _mm_min_ps(tz1, _mm_set1_ps(minT)));
+			int mask = _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+			if (mask == 0) continue;
+
+			alignas(16) float tEnter[4];
+			_mm_store_ps(tEnter, enter);
+			if (visitChildren<AnyHit>(ray, node, mask, tEnter, stack, top, minT, hit)) break;
+		}
+		return hit;
+	}
+
+	template <bool AnyHit>
+	RT_TARGET_AVX2 int traverse8(const Ray& ray, float& minT) const {
+		glm::vec3 invDir = 1.0f / ray.direction();
+		__m256 ox = _mm256_set1_ps(ray.origin().x);
+		__m256 oy = _mm256_set1_ps(ray.origin().y);
+		__m256 oz = _mm256_set1_ps(ray.origin().z);
+		__m256 ix = _mm256_set1_ps(invDir.x);
+		__m256 iy = _mm256_set1_ps(invDir.y);
+		__m256 iz = _mm256_set1_ps(invDir.z);
+		__m256 eps = _mm256_set1_ps(FLOAT_EPS);
+		bool negX = invDir.x < 0.0f, negY = invDir.y < 0.0f, negZ = invDir.z < 0.0f;
+
+		StackEntry stack[STACK_SIZE];
+		int top = 0;
+		int hit = -1;
+		stack[top++] = { 0, 0.0f };
+		while (top > 0) {
+			StackEntry entry = stack[--top];
+			if (entry.t > minT) continue;
+			const WideBVHNode<8>& node = _nodes8[entry.node];
+
+			// 按方向符号选取近、远平面，空槽（min > max）因此恒不命中
+			__m256 tx0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negX ? node.maxX : node.minX), ox), ix);
+			__m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negX ? node.minX : node.maxX), ox), ix);
+			__m256 ty0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negY ? node.maxY : node.minY), oy), iy);
+			__m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negY ? node.minY : node.maxY), oy), iy);
+			__m256 tz0 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negZ ? node.maxZ : node.minZ), oz), iz);
+			__m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(negZ ? node.minZ : node.maxZ), oz), iz);
+			__m256 enter = _mm256_max_ps(_mm256_max_ps(tx0, ty0), _mm256_max_ps(tz0, eps));
+			__m256 exit = _mm256_min_ps(_mm256_min_ps(tx1, ty1), _mm256_min_ps(tz1, _mm256_set1_ps(minT)));
+			int mask = _mm256_movemask_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ));
+			if (mask == 0) continue;
+
+			alignas(32) float tEnter[8];
+			_mm256_store_ps(tEnter, enter);
+			if (visitChildren<AnyHit>(ray, node, mask, tEnter, stack, top, minT, hit)) break;
+		}
+		return hit;
+	}
+
+	const BVH& _bvh;
+	int _width;
+	AlignedVector<WideBVHNode<4>> _nodes4;
+	AlignedVector<WideBVHNode<8>> _nodes8;
+};
+
+#endif // !WIDE_BVH_H